@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature>
+class FunctionRef;
+
+// Non-owning reference to a callable. Unlike `std::function` it never
+// allocates; the callable must outlive the reference, as for a parameter.
+template <typename Result, typename... Args>
+class FunctionRef<Result(Args...)> {
+ public:
+  template <typename Function>
+    requires(!std::is_same_v<std::remove_cvref_t<Function>, FunctionRef> &&
+             std::is_invocable_r_v<Result, Function&, Args...>)
+  inline FunctionRef(Function&& function)
+      : object_(const_cast<void*>(
+            static_cast<const void*>(std::addressof(function)))),
+        call_([](void* object, Args... args) -> Result {
+          return (*static_cast<std::remove_reference_t<Function>*>(object))(
+              std::forward<Args>(args)...);
+        }) {}
+
+  inline Result operator()(Args... args) const {
+    return call_(object_, std::forward<Args>(args)...);
+  }
+
+ private:
+  void* object_;
+  Result (*call_)(void*, Args...);
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "matrix_view.h"
+
+enum class ImageLayout {
+  // Rows one after another.
+  kRowMajor,
+  // Square tiles one after another, rows one after another within a tile.
+  kTiled,
+  // Square tiles one after another, Morton (Z) order within a tile.
+  kMorton,
+};
+
+// Two-dimensional array with a choice of memory layout. Rows, or tiles for
+// the tiled layouts, start on cache line boundaries, so threads that write
+// distinct rows or tiles never share a cache line.
+template <typename T>
+class Image {
+  static_assert(std::is_trivially_copyable_v<T> &&
+                std::is_trivially_destructible_v<T>);
+
+ public:
+  static constexpr size_t kCacheLineSize = 64;
+
+  // `tile_size` is a power of two of at most 256 and only used by the tiled
+  // layouts.
+  inline Image(size_t rows, size_t columns,
+               ImageLayout layout = ImageLayout::kRowMajor,
+               size_t tile_size = 16)
+      : rows_(rows),
+        columns_(columns),
+        layout_(layout),
+        tile_size_(tile_size),
+        tile_shift_(static_cast<unsigned int>(std::countr_zero(tile_size))),
+        tile_columns_((columns + tile_size - 1) / tile_size) {
+    assert(std::has_single_bit(tile_size) && tile_size <= 256);
+    size_t size = 0;
+    if (layout == ImageLayout::kRowMajor) {
+      row_stride_ = PadToCacheLine(columns);
+      size = rows * row_stride_;
+    } else {
+      tile_stride_ = PadToCacheLine(tile_size * tile_size);
+      size = ((rows + tile_size - 1) / tile_size) * tile_columns_ *
+             tile_stride_;
+    }
+    elements_.reset(static_cast<T*>(::operator new[](
+        std::max(size, size_t{1}) * sizeof(T),
+        std::align_val_t{kCacheLineSize})));
+    std::uninitialized_value_construct_n(elements_.get(), size);
+  }
+
+  inline const T& At(size_t row, size_t column) const {
+    assert(row < rows_ && column < columns_);
+    return elements_[Offset(row, column)];
+  }
+
+  inline T& At(size_t row, size_t column) {
+    assert(row < rows_ && column < columns_);
+    return elements_[Offset(row, column)];
+  }
+
+  inline size_t Rows() const { return rows_; }
+
+  inline size_t Columns() const { return columns_; }
+
+  inline ImageLayout Layout() const { return layout_; }
+
+  inline size_t TileSize() const { return tile_size_; }
+
+  // Copy rows `[first_row, last_row)` into the same rows of the row-major
+  // `output`, e.g. one band of tile rows per thread.
+  inline void Linearize(MatrixView<T>& output, size_t first_row,
+                        size_t last_row) const {
+    assert(output.Rows() == rows_ && output.Columns() == columns_ &&
+           last_row <= rows_);
+    for (size_t row = first_row; row < last_row; ++row) {
+      if (layout_ == ImageLayout::kMorton) {
+        for (size_t column = 0; column < columns_; ++column) {
+          output.At(row, column) = elements_[Offset(row, column)];
+        }
+        continue;
+      }
+      // Rows of the other layouts are contiguous within a tile.
+      const size_t run =
+          layout_ == ImageLayout::kRowMajor ? columns_ : tile_size_;
+      for (size_t column = 0; column < columns_; column += run) {
+        std::copy_n(&elements_[Offset(row, column)],
+                    std::min(run, columns_ - column), &output.At(row, column));
+      }
+    }
+  }
+
+ private:
+  struct AlignedDelete {
+    inline void operator()(T* elements) const {
+      ::operator delete[](elements, std::align_val_t{kCacheLineSize});
+    }
+  };
+
+  // Smallest count of at least `count` elements that fills whole cache lines.
+  static inline size_t PadToCacheLine(size_t count) {
+    while ((count * sizeof(T)) % kCacheLineSize != 0) {
+      ++count;
+    }
+    return count;
+  }
+
+  // Interleave the bits of `x` and `y`, `x` in the even bits.
+  static inline size_t EncodeMorton(size_t x, size_t y) {
+    const auto spread = [](size_t v) {
+      v = (v | (v << 4U)) & 0x0F0FU;
+      v = (v | (v << 2U)) & 0x3333U;
+      v = (v | (v << 1U)) & 0x5555U;
+      return v;
+    };
+    return spread(x) | (spread(y) << 1U);
+  }
+
+  inline size_t Offset(size_t row, size_t column) const {
+    if (layout_ == ImageLayout::kRowMajor) {
+      return row * row_stride_ + column;
+    }
+    const size_t tile =
+        (row >> tile_shift_) * tile_columns_ + (column >> tile_shift_);
+    const size_t x = column & (tile_size_ - 1);
+    const size_t y = row & (tile_size_ - 1);
+    const size_t index = layout_ == ImageLayout::kTiled
+                             ? (y << tile_shift_) + x
+                             : EncodeMorton(x, y);
+    return tile * tile_stride_ + index;
+  }
+
+  size_t rows_;
+  size_t columns_;
+  ImageLayout layout_;
+  size_t tile_size_;
+  unsigned int tile_shift_;
+  size_t tile_columns_;
+  size_t row_stride_ = 0;
+  size_t tile_stride_ = 0;
+  std::unique_ptr<T[], AlignedDelete> elements_;
+};
@@ -9,7 +9,7 @@ template <typename T>
 class MatrixView {
  public:
   inline MatrixView(std::span<T> elements, size_t rows, size_t columns)
-      : elements_(elements), rows_(rows), columns_(columns) {
+      : elements_(elements), rows_(rows), columns_(columns), stride_(columns) {
     assert(rows * columns == elements.size());
   }
 
@@ -27,25 +27,39 @@ class MatrixView {
                               size_t num_rows, size_t num_columns) const {
     assert(start_row + num_rows <= rows_ &&
            start_column + num_columns <= columns_);
-    auto sub_elements = elements_.subspan(
-        start_row * num_columns + start_column, num_columns * num_rows);
-    return MatrixView(sub_elements, num_rows, num_columns);
+    // Rows of the submatrix keep the stride of this matrix.
+    const size_t size =
+        num_rows == 0 ? 0 : (num_rows - 1) * stride_ + num_columns;
+    auto sub_elements =
+        elements_.subspan(Offset(start_row, start_column), size);
+    return MatrixView(sub_elements, num_rows, num_columns, stride_);
   }
 
   inline size_t Rows() const { return rows_; }
 
   inline size_t Columns() const { return columns_; }
 
-  inline void Clear(T value = {}) { std::ranges::fill(elements_, value); }
+  inline void Clear(T value = {}) {
+    for (size_t row = 0; row < rows_; ++row) {
+      std::ranges::fill(elements_.subspan(Offset(row, 0), columns_), value);
+    }
+  }
 
+  // Elements from the first to the last one, including the parts of the
+  // parent's rows between the rows of a submatrix.
   inline auto Elements() { return elements_; }
 
  private:
   std::span<T> elements_;
   size_t rows_;
   size_t columns_;
+  size_t stride_;
+
+  inline MatrixView(std::span<T> elements, size_t rows, size_t columns,
+                    size_t stride)
+      : elements_(elements), rows_(rows), columns_(columns), stride_(stride) {}
 
   inline size_t Offset(size_t row, size_t column) const {
-    return columns_ * row + column;
+    return stride_ * row + column;
   }
 };
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Single producer, single consumer buffer of immutable snapshots. The writer
+// fills the back slot and publishes it; the reader takes the most recent
+// published slot. Neither side ever waits: a third slot is exchanged through an
+// atomic, so the writer can always fill a slot the reader does not hold.
+template <typename T>
+class SnapshotBuffer {
+ public:
+  // Writer side: the slot to fill before `Publish`. It holds an older snapshot,
+  // so every field has to be overwritten.
+  inline T& Back() { return slots_[back_].value; }
+
+  // Writer side: make the back slot the latest snapshot.
+  inline void Publish() {
+    slots_[back_].version = ++published_version_;
+    const auto previous =
+        latest_.exchange(back_ | kFreshBit, std::memory_order_acq_rel);
+    back_ = previous & kIndexMask;
+  }
+
+  // Reader side: switch to the latest snapshot if a newer one was published.
+  // Returns whether the front slot changed.
+  inline bool Acquire() {
+    if ((latest_.load(std::memory_order_relaxed) & kFreshBit) == 0) {
+      return false;
+    }
+    const auto previous = latest_.exchange(front_, std::memory_order_acq_rel);
+    front_ = previous & kIndexMask;
+    return true;
+  }
+
+  // Reader side: the snapshot taken by the last `Acquire`; it stays unchanged
+  // until the next one.
+  inline const T& Front() const { return slots_[front_].value; }
+
+  // Reader side: version of `Front`, 0 before the first publish.
+  inline uint64_t FrontVersion() const { return slots_[front_].version; }
+
+ private:
+  static constexpr uint32_t kIndexMask = 0b011;
+  static constexpr uint32_t kFreshBit = 0b100;
+
+  struct Slot {
+    T value{};
+    uint64_t version = 0;
+  };
+
+  std::array<Slot, 3> slots_{};
+  // Index of the slot between the writer and the reader, with `kFreshBit` set
+  // while the reader has not taken it yet.
+  std::atomic<uint32_t> latest_ = 1;
+  // Owned by the writer.
+  uint32_t back_ = 0;
+  uint64_t published_version_ = 0;
+  // Owned by the reader.
+  uint32_t front_ = 2;
+};
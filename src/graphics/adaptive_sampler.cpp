@@ -0,0 +1,168 @@
+#include "adaptive_sampler.h"
+
+#include <cassert>
+#include <cmath>
+
+#include "../utils/frame_arena.h"
+
+namespace {
+// Integer hash with good avalanche, used to jitter samples deterministically.
+inline uint32_t Hash(uint32_t x) {
+  x ^= x >> 16U;
+  x *= 0x7feb352dU;
+  x ^= x >> 15U;
+  x *= 0x846ca68bU;
+  x ^= x >> 16U;
+  return x;
+}
+
+// Map the upper 24 bits of a hash to `[0, 1)`.
+inline float ToUnitFloat(uint32_t hash) {
+  constexpr auto kInverse24Bit = 1.0f / static_cast<float>(1U << 24U);
+  return static_cast<float>(hash >> 8U) * kInverse24Bit;
+}
+
+inline float CalculateColorDifference(const DirectX::XMFLOAT3A& a,
+                                      const DirectX::XMFLOAT3A& b) {
+  return std::fmaxf(std::abs(a.x - b.x),
+                    std::fmaxf(std::abs(a.y - b.y), std::abs(a.z - b.z)));
+}
+
+// Check if two samples hit different primitives or lie at different depths.
+inline bool IsGeometryEdge(const ray_tracer::Sample& a,
+                           const ray_tracer::Sample& b,
+                           float depth_threshold) {
+  if (a.mesh_index != b.mesh_index || a.face_index != b.face_index) {
+    return true;
+  }
+  if (a.mesh_index == ray_tracer::Sample::kNoMesh) {
+    return false;
+  }
+  const float relative_depth =
+      std::abs(a.depth - b.depth) / std::fminf(a.depth, b.depth);
+  return relative_depth > depth_threshold;
+}
+}  // namespace
+
+ray_tracer::AdaptiveSampler::AdaptiveSampler(
+    unsigned int width, unsigned int height,
+    const AdaptiveSamplerSettings& settings,
+    utils::numa::ThreadPool& thread_pool)
+    : width_(width),
+      height_(height),
+      settings_(settings),
+      thread_pool_(thread_pool),
+      pixels_(static_cast<size_t>(width) * height),
+      samples_(pixels_.size()),
+      contrasts_(pixels_.size()),
+      colors_(pixels_.size()) {
+  assert(settings.max_samples_per_pixel > 0);
+  for (auto y = 0U; y < height; ++y) {
+    for (auto x = 0U; x < width; ++x) {
+      pixels_[static_cast<size_t>(y) * width + x] = {x, y};
+    }
+  }
+}
+
+float ray_tracer::AdaptiveSampler::CalculateContrast(unsigned int x,
+                                                     unsigned int y) const {
+  const auto& center = samples_[static_cast<size_t>(y) * width_ + x];
+  float color_difference = 0.0f;
+  bool geometry_edge = false;
+
+  const auto compare = [&](unsigned int neighbor_x, unsigned int neighbor_y) {
+    const auto& neighbor =
+        samples_[static_cast<size_t>(neighbor_y) * width_ + neighbor_x];
+    color_difference =
+        std::fmaxf(color_difference,
+                   CalculateColorDifference(center.color, neighbor.color));
+    geometry_edge |=
+        IsGeometryEdge(center, neighbor, settings_.depth_threshold);
+  };
+
+  if (x > 0) compare(x - 1, y);
+  if (x + 1 < width_) compare(x + 1, y);
+  if (y > 0) compare(x, y - 1);
+  if (y + 1 < height_) compare(x, y + 1);
+
+  // Rank by visible contrast; pure geometry edges get the lowest flagged rank.
+  const float contrast = color_difference / settings_.color_threshold;
+  if (contrast > 1.0f) {
+    return contrast;
+  }
+  return geometry_edge ? 1.0f : 0.0f;
+}
+
+unsigned int ray_tracer::AdaptiveSampler::SelectRefinedPixels() {
+  thread_pool_.ParallelFor(
+      pixels_.size(), width_, [this](size_t begin, size_t end) {
+        for (size_t pixel_index = begin; pixel_index < end; ++pixel_index) {
+          contrasts_[pixel_index] =
+              CalculateContrast(pixels_[pixel_index].x, pixels_[pixel_index].y);
+        }
+      });
+
+  const auto flagged_pixels =
+      utils::memory::AllocateFrameArray<uint32_t>(pixels_.size());
+  size_t flagged_count = 0;
+  for (uint32_t pixel_index = 0; pixel_index < contrasts_.size();
+       ++pixel_index) {
+    if (contrasts_[pixel_index] > 0.0f) {
+      flagged_pixels[flagged_count++] = pixel_index;
+    }
+  }
+  refined_pixels_ = flagged_pixels.first(flagged_count);
+  stats_.edge_pixels = refined_pixels_.size();
+
+  const size_t first_pass_rays = pixels_.size();
+  const size_t extra_budget = settings_.ray_budget > first_pass_rays
+                                  ? settings_.ray_budget - first_pass_rays
+                                  : 0;
+  const size_t max_extra_samples = settings_.max_samples_per_pixel - 1;
+  if (refined_pixels_.empty() || extra_budget == 0 || max_extra_samples == 0) {
+    refined_pixels_ = {};
+    stats_.refined_pixels = 0;
+    stats_.extra_rays = 0;
+    return 0;
+  }
+
+  // A single extra sample barely helps, so when the budget cannot cover
+  // every edge, refine fewer pixels with at least a 2x2 stratification.
+  const size_t min_extra_samples =
+      std::min(max_extra_samples, static_cast<size_t>(4));
+  size_t extra_samples =
+      std::min(max_extra_samples, extra_budget / refined_pixels_.size());
+  if (extra_samples < min_extra_samples) {
+    extra_samples = min_extra_samples;
+    const size_t pixel_count =
+        std::min(extra_budget / extra_samples, refined_pixels_.size());
+    std::nth_element(refined_pixels_.begin(),
+                     refined_pixels_.begin() +
+                         static_cast<std::ptrdiff_t>(pixel_count),
+                     refined_pixels_.end(), [this](uint32_t a, uint32_t b) {
+                       return contrasts_[a] > contrasts_[b];
+                     });
+    refined_pixels_ = refined_pixels_.first(pixel_count);
+  }
+
+  stats_.refined_pixels = refined_pixels_.size();
+  stats_.extra_rays = refined_pixels_.size() * extra_samples;
+  return static_cast<unsigned int>(extra_samples);
+}
+
+DirectX::XMFLOAT2 ray_tracer::AdaptiveSampler::GetStratifiedOffset(
+    uint32_t pixel_index, unsigned int sample_index,
+    unsigned int sample_count) {
+  // Place the samples in distinct cells of a `strata x strata` grid, starting
+  // at a per-pixel cell so partially filled grids are not biased.
+  const auto strata = static_cast<unsigned int>(
+      std::ceil(std::sqrt(static_cast<float>(sample_count))));
+  const uint32_t pixel_hash = Hash(pixel_index);
+  const unsigned int cell = (sample_index + pixel_hash) % (strata * strata);
+  const uint32_t jitter_hash = Hash(pixel_hash ^ (sample_index + 1U));
+  const float jitter_x = ToUnitFloat(jitter_hash);
+  const float jitter_y = ToUnitFloat(Hash(jitter_hash));
+  const float inverse_strata = 1.0f / static_cast<float>(strata);
+  return {(static_cast<float>(cell % strata) + jitter_x) * inverse_strata,
+          (static_cast<float>(cell / strata) + jitter_y) * inverse_strata};
+}
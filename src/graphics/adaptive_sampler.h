@@ -0,0 +1,183 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "../common/matrix_view.h"
+#include "../utils/numa.h"
+#include "ray_tracer.h"
+
+namespace ray_tracer {
+// A single camera ray sample and the primitive it hit. The normal and albedo
+// of pixel center samples guide the denoiser.
+struct Sample {
+  static constexpr uint32_t kNoMesh = std::numeric_limits<uint32_t>::max();
+
+  DirectX::XMFLOAT3A color;
+  DirectX::XMFLOAT3A normal;
+  DirectX::XMFLOAT3A albedo;
+  float depth;
+  uint32_t mesh_index;
+  uint32_t face_index;
+};
+
+// `albedo` is the surface color of the hit of the ray before lighting. The
+// normal and albedo are only filled in with `guides`, for samples whose guides
+// are kept.
+inline Sample MakeSample(std::span<const scene::SharedMesh> meshes,
+                         std::span<const scene::Primitive> primitives,
+                         DirectX::FXMVECTOR color, DirectX::FXMVECTOR albedo,
+                         DirectX::FXMVECTOR world_direction,
+                         DirectX::GXMVECTOR world_origin,
+                         const std::optional<Hit>& hit, bool guides) {
+  Sample sample{};
+  DirectX::XMStoreFloat3A(&sample.color, color);
+  if (guides && hit.has_value()) {
+    DirectX::XMStoreFloat3A(&sample.normal,
+                            GetHitNormal(meshes, primitives, *hit,
+                                         world_direction, world_origin));
+    DirectX::XMStoreFloat3A(&sample.albedo, albedo);
+  }
+  sample.depth = hit ? hit->distance : std::numeric_limits<float>::infinity();
+  sample.mesh_index = hit ? hit->mesh_index : Sample::kNoMesh;
+  sample.face_index = hit ? hit->face_index : 0;
+  return sample;
+}
+
+struct AdaptiveSamplerSettings {
+  // Maximum number of camera rays per frame, first pass included.
+  size_t ray_budget;
+  // Maximum number of samples of a refined pixel, first sample included.
+  unsigned int max_samples_per_pixel;
+  // Per-channel color difference to a neighbor that marks an edge.
+  float color_threshold;
+  // Relative depth difference to a neighbor that marks an edge.
+  float depth_threshold;
+};
+
+struct AdaptiveSamplerStats {
+  size_t edge_pixels;
+  size_t refined_pixels;
+  size_t extra_rays;
+};
+
+// Shoots one ray through each pixel center, then spends the remaining ray
+// budget on stratified samples of pixels that lie on color, depth or primitive
+// edges. Rows are rendered by `thread_pool` in per-node shares, and the buffers
+// are first touched there, so each node keeps its rows in local memory.
+class AdaptiveSampler {
+ public:
+  AdaptiveSampler(unsigned int width, unsigned int height,
+                  const AdaptiveSamplerSettings& settings,
+                  utils::numa::ThreadPool& thread_pool);
+
+  // `sample_function(x, y, offset_x, offset_y, guides)` traces a ray through
+  // the given position inside pixel `(x, y)` and returns a `Sample`. Only the
+  // pixel center samples are called with `guides`; the extra samples only
+  // contribute their color.
+  template <typename SampleFunction>
+  void Render(SampleFunction&& sample_function);
+
+  inline MatrixView<DirectX::XMFLOAT3A> Colors() {
+    return MatrixView<DirectX::XMFLOAT3A>(colors_.Elements(), height_, width_);
+  }
+
+  // Samples through the pixel centers of the last frame.
+  inline MatrixView<const Sample> Samples() const {
+    return MatrixView<const Sample>(samples_.Elements(), height_, width_);
+  }
+
+  inline void SetRayBudget(size_t ray_budget) {
+    settings_.ray_budget = ray_budget;
+  }
+
+  inline void SetMaxSamplesPerPixel(unsigned int max_samples_per_pixel) {
+    assert(max_samples_per_pixel > 0);
+    settings_.max_samples_per_pixel = max_samples_per_pixel;
+  }
+
+  inline unsigned int Width() const { return width_; }
+
+  inline unsigned int Height() const { return height_; }
+
+  inline const AdaptiveSamplerSettings& GetSettings() const {
+    return settings_;
+  }
+
+  inline const AdaptiveSamplerStats& GetStats() const { return stats_; }
+
+ private:
+  // Flags edge pixels and returns the number of extra samples per flagged
+  // pixel.
+  unsigned int SelectRefinedPixels();
+
+  float CalculateContrast(unsigned int x, unsigned int y) const;
+
+  static DirectX::XMFLOAT2 GetStratifiedOffset(uint32_t pixel_index,
+                                               unsigned int sample_index,
+                                               unsigned int sample_count);
+
+  // Refined pixels per chunk of the third pass.
+  static constexpr size_t kRefinedPixelsPerChunk = 8;
+
+  unsigned int width_;
+  unsigned int height_;
+  AdaptiveSamplerSettings settings_;
+  utils::numa::ThreadPool& thread_pool_;
+  AdaptiveSamplerStats stats_{};
+  std::vector<DirectX::XMUINT2> pixels_;
+  utils::numa::FirstTouchBuffer<Sample> samples_;
+  utils::numa::FirstTouchBuffer<float> contrasts_;
+  // In the frame arena of the rendering thread.
+  std::span<uint32_t> refined_pixels_;
+  utils::numa::FirstTouchBuffer<DirectX::XMFLOAT3A> colors_;
+};
+
+template <typename SampleFunction>
+void AdaptiveSampler::Render(SampleFunction&& sample_function) {
+  // Pass 1: one sample through each pixel center, one row per chunk.
+  thread_pool_.ParallelFor(
+      pixels_.size(), width_, [&](size_t begin, size_t end) {
+        for (size_t pixel_index = begin; pixel_index < end; ++pixel_index) {
+          const auto& p = pixels_[pixel_index];
+          samples_[pixel_index] = sample_function(p.x, p.y, 0.5f, 0.5f, true);
+          colors_[pixel_index] = samples_[pixel_index].color;
+        }
+      });
+
+  // Pass 2: find edges and split the remaining budget between them.
+  const unsigned int extra_samples = SelectRefinedPixels();
+
+  // Pass 3: stratified samples of the flagged pixels only.
+  thread_pool_.ParallelFor(
+      refined_pixels_.size(), kRefinedPixelsPerChunk,
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          const uint32_t pixel_index = refined_pixels_[i];
+          const auto& p = pixels_[pixel_index];
+          DirectX::XMVECTOR color_sum =
+              DirectX::XMLoadFloat3A(&samples_[pixel_index].color);
+          for (auto sample_index = 0U; sample_index < extra_samples;
+               ++sample_index) {
+            const auto offset =
+                GetStratifiedOffset(pixel_index, sample_index, extra_samples);
+            const Sample sample =
+                sample_function(p.x, p.y, offset.x, offset.y, false);
+            color_sum = DirectX::XMVectorAdd(
+                color_sum, DirectX::XMLoadFloat3A(&sample.color));
+          }
+          DirectX::XMStoreFloat3A(
+              &colors_[pixel_index],
+              DirectX::XMVectorScale(
+                  color_sum, 1.0f / static_cast<float>(extra_samples + 1)));
+        }
+      });
+}
+}  // namespace ray_tracer
@@ -0,0 +1,195 @@
+#include "ambient_occlusion.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../utils/xm.h"
+#include "ray_tracer.h"
+
+namespace {
+// Cells probed from the home slot of a key before one is replaced.
+constexpr size_t kProbeCount = 8;
+// Levels of cell sizes above the finest one.
+constexpr int kMaxLevel = 24;
+// Offset of ray origins along the normal, so rays do not hit the surface they
+// leave.
+constexpr float kRayOffset = 1.0e-3f;
+
+// Axis and side the normal faces most, from 0 to 5.
+inline uint64_t GetNormalBucket(DirectX::FXMVECTOR normal) {
+  DirectX::XMFLOAT3 n{};
+  DirectX::XMStoreFloat3(&n, normal);
+  const float x = std::fabs(n.x);
+  const float y = std::fabs(n.y);
+  const float z = std::fabs(n.z);
+  if (x >= y && x >= z) {
+    return n.x < 0.0f ? 0 : 1;
+  }
+  if (y >= z) {
+    return n.y < 0.0f ? 2 : 3;
+  }
+  return n.z < 0.0f ? 4 : 5;
+}
+
+// Hash of the cell coordinates, level and normal bucket; never zero, which
+// marks empty cells.
+inline uint64_t MakeCellKey(int64_t x, int64_t y, int64_t z, int level,
+                            uint64_t normal_bucket) {
+  uint64_t key = static_cast<uint64_t>(x) * 0x9E3779B97F4A7C15ULL;
+  key ^= static_cast<uint64_t>(y) * 0xC2B2AE3D27D4EB4FULL;
+  key ^= static_cast<uint64_t>(z) * 0x165667B19E3779F9ULL;
+  key ^= (static_cast<uint64_t>(level) << 3U | normal_bucket) *
+         0x27D4EB2F165667C5ULL;
+  key ^= key >> 31U;
+  key *= 0x94D049BB133111EBULL;
+  key ^= key >> 29U;
+  return key == 0 ? 1 : key;
+}
+
+inline uint32_t ReverseBits(uint32_t bits) {
+  bits = (bits << 16U) | (bits >> 16U);
+  bits = ((bits & 0x00FF00FFU) << 8U) | ((bits & 0xFF00FF00U) >> 8U);
+  bits = ((bits & 0x0F0F0F0FU) << 4U) | ((bits & 0xF0F0F0F0U) >> 4U);
+  bits = ((bits & 0x33333333U) << 2U) | ((bits & 0xCCCCCCCCU) >> 2U);
+  return ((bits & 0x55555555U) << 1U) | ((bits & 0xAAAAAAAAU) >> 1U);
+}
+
+// Fixed point fraction in [0, 1).
+inline float ToUnit(uint32_t bits) {
+  return static_cast<float>(bits >> 8U) * 0x1.0p-24f;
+}
+}  // namespace
+
+ray_tracer::AmbientOcclusionCache::AmbientOcclusionCache(
+    size_t memory_budget, const AmbientOcclusionSettings& settings)
+    : settings_(settings) {
+  const size_t cells_per_shard =
+      std::max(memory_budget / sizeof(Cell) / kShardCount, kProbeCount);
+  for (auto& shard : shards_) {
+    shard.cells.resize(cells_per_shard, Cell{.key = kEmptyKey,
+                                             .visibility = 1.0f,
+                                             .samples = 0,
+                                             .frame_samples = 0,
+                                             .frame = 0});
+  }
+}
+
+float ray_tracer::AmbientOcclusionCache::GetVisibility(
+    std::span<const scene::SharedMesh> meshes,
+    std::span<const scene::Primitive> primitives, DirectX::FXMVECTOR point,
+    DirectX::FXMVECTOR normal, float pixel_size) {
+  const int level = std::clamp(
+      static_cast<int>(std::ceil(std::log2(std::max(
+          pixel_size * settings_.cell_pixels / settings_.min_cell_size,
+          1.0f)))),
+      0, kMaxLevel);
+  const float cell_size = std::ldexp(settings_.min_cell_size, level);
+  DirectX::XMFLOAT3 cell{};
+  DirectX::XMStoreFloat3(
+      &cell, DirectX::XMVectorFloor(DirectX::XMVectorScale(
+                 point, 1.0f / cell_size)));
+  const uint64_t key = MakeCellKey(
+      static_cast<int64_t>(cell.x), static_cast<int64_t>(cell.y),
+      static_cast<int64_t>(cell.z), level, GetNormalBucket(normal));
+  auto& shard = shards_[key % kShardCount];
+
+  uint32_t sample_index = 0;
+  {
+    std::scoped_lock lock(shard.mutex);
+    auto& found = FindCell(shard, key);
+    if (found.frame != frame_) {
+      found.frame = frame_;
+      found.frame_samples = 0;
+    }
+    const uint16_t allowance = found.samples < settings_.max_samples
+                                   ? settings_.samples_per_frame
+                                   : uint16_t{1};
+    if (found.frame_samples >= allowance) {
+      ++shard.hits;
+      return found.visibility;
+    }
+    ++shard.misses;
+    sample_index = frame_ * settings_.samples_per_frame + found.frame_samples;
+    ++found.frame_samples;
+  }
+
+  // Radical inverse and golden ratio sequences over the frames, scrambled per
+  // cell so that neighboring cells do not share directions.
+  const float u =
+      ToUnit(ReverseBits(sample_index) ^ static_cast<uint32_t>(key >> 32U));
+  const float v =
+      ToUnit(sample_index * 0x9E3779B9U + static_cast<uint32_t>(key));
+  const auto direction = utils::xm::hemisphere::SampleCosine(normal, u, v);
+  const auto origin = DirectX::XMVectorMultiplyAdd(
+      normal, DirectX::XMVectorReplicate(kRayOffset), point);
+  const float visible =
+      IsOccluded(meshes, primitives, origin, direction, settings_.radius)
+          ? 0.0f
+          : 1.0f;
+
+  std::scoped_lock lock(shard.mutex);
+  auto& found = FindCell(shard, key);
+  found.samples = std::min<uint16_t>(found.samples + 1, settings_.max_samples);
+  found.visibility +=
+      (visible - found.visibility) / static_cast<float>(found.samples);
+  return found.visibility;
+}
+
+ray_tracer::AmbientOcclusionStats ray_tracer::AmbientOcclusionCache::GetStats()
+    const {
+  AmbientOcclusionStats stats{.cells = 0,
+                              .capacity_cells = 0,
+                              .hits = 0,
+                              .misses = 0,
+                              .evictions = 0};
+  for (const auto& shard : shards_) {
+    std::scoped_lock lock(shard.mutex);
+    stats.cells += shard.used_cells;
+    stats.capacity_cells += shard.cells.size();
+    stats.hits += shard.hits;
+    stats.misses += shard.misses;
+    stats.evictions += shard.evictions;
+  }
+  return stats;
+}
+
+void ray_tracer::AmbientOcclusionCache::ResetStats() {
+  for (auto& shard : shards_) {
+    std::scoped_lock lock(shard.mutex);
+    shard.hits = 0;
+    shard.misses = 0;
+    shard.evictions = 0;
+  }
+}
+
+ray_tracer::AmbientOcclusionCache::Cell&
+ray_tracer::AmbientOcclusionCache::FindCell(Shard& shard, uint64_t key) {
+  const size_t home = static_cast<size_t>(key / kShardCount);
+  Cell* empty = nullptr;
+  Cell* oldest = nullptr;
+  for (size_t probe = 0; probe < kProbeCount; ++probe) {
+    auto& cell = shard.cells[(home + probe) % shard.cells.size()];
+    if (cell.key == key) {
+      return cell;
+    }
+    if (cell.key == kEmptyKey) {
+      empty = empty != nullptr ? empty : &cell;
+    } else if (oldest == nullptr ||
+               frame_ - cell.frame > frame_ - oldest->frame) {
+      oldest = &cell;
+    }
+  }
+
+  if (empty != nullptr) {
+    ++shard.used_cells;
+  } else {
+    ++shard.evictions;
+  }
+  auto& cell = empty != nullptr ? *empty : *oldest;
+  cell = Cell{.key = key,
+              .visibility = 1.0f,
+              .samples = 0,
+              .frame_samples = 0,
+              .frame = frame_};
+  return cell;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "../scene/mesh.h"
+#include "../scene/primitive.h"
+
+namespace ray_tracer {
+struct AmbientOcclusionSettings {
+  // Occluders farther from the surface than this do not darken it.
+  float radius;
+  // Edge of the finest cells; cells grow by powers of two so that one spans
+  // about `cell_pixels` pixels.
+  float min_cell_size;
+  float cell_pixels;
+  // Samples averaged per cell. Once a cell has them, each new sample replaces
+  // an equal share of the average, so moving occluders fade in.
+  uint16_t max_samples;
+  // Rays traced per cell and frame until it has `max_samples`; afterwards one
+  // per frame keeps it up to date.
+  uint16_t samples_per_frame;
+};
+
+struct AmbientOcclusionStats {
+  size_t cells;
+  size_t capacity_cells;
+  // Lookups answered without tracing a ray.
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+};
+
+// Ambient occlusion averaged over world space cells keyed by position, cell
+// size and the axis the normal faces, in a hash grid of fixed size. Cells are
+// filled a few rays per frame and stay valid when the camera moves; when the
+// grid is full, the least recently used cell in the probe range is replaced.
+class AmbientOcclusionCache {
+ public:
+  AmbientOcclusionCache(size_t memory_budget,
+                        const AmbientOcclusionSettings& settings);
+
+  AmbientOcclusionCache(const AmbientOcclusionCache&) = delete;
+  AmbientOcclusionCache& operator=(const AmbientOcclusionCache&) = delete;
+
+  // Starts a frame with fresh ray allowances. Not to be called during
+  // lookups.
+  inline void BeginFrame() { ++frame_; }
+
+  // Unoccluded fraction of the hemisphere above `point` with the unit
+  // `normal`, weighted by the cosine. `pixel_size` is the width of a pixel at
+  // `point` and selects the cell size. Thread-safe.
+  float GetVisibility(std::span<const scene::SharedMesh> meshes,
+                      std::span<const scene::Primitive> primitives,
+                      DirectX::FXMVECTOR point, DirectX::FXMVECTOR normal,
+                      float pixel_size);
+
+  AmbientOcclusionStats GetStats() const;
+
+  void ResetStats();
+
+ private:
+  static constexpr size_t kShardCount = 64;
+  static constexpr uint64_t kEmptyKey = 0;
+
+  struct Cell {
+    uint64_t key;
+    float visibility;
+    uint16_t samples;
+    // Rays handed out in `frame`.
+    uint16_t frame_samples;
+    uint32_t frame;
+  };
+
+  // Cells are spread over shards, each with its own lock, so lookups on
+  // different threads rarely wait for each other.
+  struct alignas(64) Shard {
+    mutable std::mutex mutex;
+    std::vector<Cell> cells;
+    size_t used_cells = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+  };
+
+  // Cell of `key` in `shard`, inserted if missing. Locked by the caller.
+  Cell& FindCell(Shard& shard, uint64_t key);
+
+  AmbientOcclusionSettings settings_;
+  uint32_t frame_ = 0;
+  std::array<Shard, kShardCount> shards_;
+};
+}  // namespace ray_tracer
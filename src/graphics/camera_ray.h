@@ -0,0 +1,64 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cmath>
+#include <numbers>
+
+namespace ray_tracer {
+// Map a position in pixel coordinates to the camera space plane `z = -1`.
+inline DirectX::XMFLOAT2 GetCameraPlanePoint(float pixel_x, float pixel_y,
+                                             int width, int height) {
+  // Calculate half of the horizontal field of view angle (in radians).
+  const float fov_horizontal = std::numbers::pi_v<float> / 2.0f;
+  const float half_angle_tan = std::tan(fov_horizontal / 2.0f);
+
+  // Calculate the inverse aspect ratio.
+  const float aspect_ratio =
+      static_cast<float>(width) / static_cast<float>(height);
+  const float inverse_aspect_ratio = 1.0f / aspect_ratio;
+
+  const float ndc_x =
+      std::lerp(-1.0f, 1.0f, pixel_x / static_cast<float>(width));
+  const float ndc_y =
+      std::lerp(1.0f, -1.0f, pixel_y / static_cast<float>(height));
+
+  return {half_angle_tan * ndc_x,
+          inverse_aspect_ratio * half_angle_tan * ndc_y};
+}
+
+// Angle between the rays through two neighboring pixels at the center of the
+// view, the spread of the ray cone of a pixel.
+inline float GetPixelSpreadAngle(int width, int height) {
+  const float center_x = static_cast<float>(width) / 2.0f;
+  const float center_y = static_cast<float>(height) / 2.0f;
+  return std::atan(GetCameraPlanePoint(center_x + 1.0f, center_y, width,
+                                       height)
+                       .x -
+                   GetCameraPlanePoint(center_x, center_y, width, height).x);
+}
+
+// Create a world space ray through pixel `(x, y)`; the offsets select the
+// sample position inside the pixel, `(0.5, 0.5)` being its center.
+inline void CreateCameraRay(DirectX::XMVECTOR& out_origin,
+                            DirectX::XMVECTOR& out_direction, unsigned int x,
+                            unsigned int y, int width, int height,
+                            const DirectX::XMMATRIX& camera_to_world_matrix,
+                            float offset_x = 0.5f, float offset_y = 0.5f) {
+  const auto camera_point =
+      GetCameraPlanePoint(static_cast<float>(x) + offset_x,
+                          static_cast<float>(y) + offset_y, width, height);
+
+  const DirectX::XMVECTOR camera_ndc =
+      DirectX::XMVectorSet(camera_point.x, camera_point.y, -1.0f, 0.0f);
+
+  const DirectX::XMVECTOR xm_world_origin =
+      DirectX::XMVector3Transform(DirectX::g_XMZero, camera_to_world_matrix);
+  const DirectX::XMVECTOR xm_world_target =
+      DirectX::XMVector3Transform(camera_ndc, camera_to_world_matrix);
+
+  out_origin = xm_world_origin;
+  out_direction = DirectX::XMVector3Normalize(
+      DirectX::XMVectorSubtract(xm_world_target, xm_world_origin));
+}
+}  // namespace ray_tracer
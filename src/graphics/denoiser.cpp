@@ -0,0 +1,134 @@
+#include "denoiser.h"
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+// B3 spline weights by distance to the kernel center.
+constexpr std::array<float, 3> kKernelWeights = {3.0f / 8.0f, 1.0f / 4.0f,
+                                                 1.0f / 16.0f};
+
+// Weights below `exp(-16)` do not change the result.
+constexpr auto kMaxExponent = 16.0f;
+
+inline float CalculateLuminance(DirectX::FXMVECTOR color) {
+  return DirectX::XMVectorGetX(DirectX::XMVector3Dot(
+      color, DirectX::XMVectorSet(0.2126f, 0.7152f, 0.0722f, 0.0f)));
+}
+}  // namespace
+
+ray_tracer::Denoiser::Denoiser(unsigned int width, unsigned int height,
+                               const DenoiserSettings& settings,
+                               utils::numa::ThreadPool& thread_pool)
+    : width_(width),
+      height_(height),
+      settings_(settings),
+      thread_pool_(thread_pool),
+      buffers_{utils::numa::FirstTouchBuffer<DirectX::XMFLOAT3A>(
+                   static_cast<size_t>(width) * height),
+               utils::numa::FirstTouchBuffer<DirectX::XMFLOAT3A>(
+                   static_cast<size_t>(width) * height)} {
+  assert(settings.iterations > 0);
+}
+
+void ray_tracer::Denoiser::Denoise(const MatrixView<DirectX::XMFLOAT3A>& colors,
+                                   const MatrixView<const Sample>& guides) {
+  assert(colors.Rows() == height_ && colors.Columns() == width_);
+  for (auto iteration = 0U; iteration < settings_.iterations; ++iteration) {
+    const auto input =
+        iteration == 0
+            ? colors
+            : MatrixView<DirectX::XMFLOAT3A>(
+                  buffers_[(iteration + 1) % 2].Elements(), height_, width_);
+    auto output = MatrixView<DirectX::XMFLOAT3A>(
+        buffers_[iteration % 2].Elements(), height_, width_);
+    const int step = 1 << iteration;
+    // Later passes average over larger areas that are already smooth.
+    const float color_sigma =
+        settings_.color_sigma / static_cast<float>(step);
+
+    thread_pool_.ParallelFor(
+        static_cast<size_t>(width_) * height_, width_,
+        [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            FilterPixel(output, input, guides,
+                        static_cast<unsigned int>(i % width_),
+                        static_cast<unsigned int>(i / width_), step,
+                        color_sigma);
+          }
+        });
+  }
+}
+
+void ray_tracer::Denoiser::FilterPixel(
+    MatrixView<DirectX::XMFLOAT3A>& output,
+    const MatrixView<DirectX::XMFLOAT3A>& input,
+    const MatrixView<const Sample>& guides, unsigned int x, unsigned int y,
+    int step, float color_sigma) const {
+  const auto& center = guides.At(y, x);
+  const auto center_color = DirectX::XMLoadFloat3A(&input.At(y, x));
+  // Nothing to smooth in the background.
+  if (center.mesh_index == Sample::kNoMesh) {
+    output.At(y, x) = input.At(y, x);
+    return;
+  }
+
+  const auto center_normal = DirectX::XMLoadFloat3A(&center.normal);
+  const auto center_albedo = DirectX::XMLoadFloat3A(&center.albedo);
+  const float center_luminance = CalculateLuminance(center_color);
+  const float depth_scale =
+      1.0f / (settings_.depth_sigma * center.depth * static_cast<float>(step));
+
+  DirectX::XMVECTOR color_sum = DirectX::g_XMZero;
+  float weight_sum = 0.0f;
+  for (int dy = -2; dy <= 2; ++dy) {
+    const int sample_y = static_cast<int>(y) + dy * step;
+    if (sample_y < 0 || sample_y >= static_cast<int>(height_)) {
+      continue;
+    }
+    for (int dx = -2; dx <= 2; ++dx) {
+      const int sample_x = static_cast<int>(x) + dx * step;
+      if (sample_x < 0 || sample_x >= static_cast<int>(width_)) {
+        continue;
+      }
+
+      const auto& guide = guides.At(sample_y, sample_x);
+      if (guide.mesh_index != center.mesh_index) {
+        continue;
+      }
+      const auto color = DirectX::XMLoadFloat3A(&input.At(sample_y, sample_x));
+
+      const float cosine = DirectX::XMVectorGetX(DirectX::XMVector3Dot(
+          center_normal, DirectX::XMLoadFloat3A(&guide.normal)));
+      if (cosine <= 0.0f) {
+        continue;
+      }
+      const float albedo_distance = DirectX::XMVectorGetX(
+          DirectX::XMVector3LengthSq(DirectX::XMVectorSubtract(
+              center_albedo, DirectX::XMLoadFloat3A(&guide.albedo))));
+      // `exp(-power * (1 - cosine))` approximates `cosine^power` near 1 and
+      // shares the exponential with the other terms.
+      const float exponent =
+          settings_.normal_power * (1.0f - cosine) +
+          std::abs(guide.depth - center.depth) * depth_scale +
+          albedo_distance / settings_.albedo_sigma +
+          std::abs(CalculateLuminance(color) - center_luminance) / color_sigma;
+      // Skip negligible weights, which would only add denormals.
+      if (exponent > kMaxExponent) {
+        continue;
+      }
+
+      const float weight = kKernelWeights[std::abs(dx)] *
+                           kKernelWeights[std::abs(dy)] * std::exp(-exponent);
+      color_sum = DirectX::XMVectorMultiplyAdd(
+          color, DirectX::XMVectorReplicate(weight), color_sum);
+      weight_sum += weight;
+    }
+  }
+
+  // The center always contributes, so `weight_sum` is positive.
+  DirectX::XMStoreFloat3A(&output.At(y, x),
+                          DirectX::XMVectorScale(color_sum, 1.0f / weight_sum));
+}
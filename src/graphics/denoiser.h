@@ -0,0 +1,58 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "../common/matrix_view.h"
+#include "../utils/numa.h"
+#include "adaptive_sampler.h"
+
+namespace ray_tracer {
+struct DenoiserSettings {
+  // Filter passes; pass `i` samples the 5x5 kernel with a step of `2^i`.
+  unsigned int iterations;
+  // Luminance difference at which weights fall to `1/e`, halved every pass.
+  float color_sigma;
+  // Relative depth difference per pixel of distance at which weights fall to
+  // `1/e`.
+  float depth_sigma;
+  // Exponent of the cosine between normals.
+  float normal_power;
+  // Squared albedo difference at which weights fall to `1/e`.
+  float albedo_sigma;
+};
+
+// Edge-avoiding a-trous wavelet filter. Smooths colors across pixels that show
+// the same mesh at a similar depth, normal and albedo, as given by the pixel
+// center samples.
+class Denoiser {
+ public:
+  Denoiser(unsigned int width, unsigned int height,
+           const DenoiserSettings& settings,
+           utils::numa::ThreadPool& thread_pool);
+
+  // Filter `colors`; the result is in `Colors` afterwards.
+  void Denoise(const MatrixView<DirectX::XMFLOAT3A>& colors,
+               const MatrixView<const Sample>& guides);
+
+  inline MatrixView<DirectX::XMFLOAT3A> Colors() {
+    return MatrixView<DirectX::XMFLOAT3A>(
+        buffers_[(settings_.iterations + 1) % 2].Elements(), height_, width_);
+  }
+
+  inline const DenoiserSettings& GetSettings() const { return settings_; }
+
+ private:
+  void FilterPixel(MatrixView<DirectX::XMFLOAT3A>& output,
+                   const MatrixView<DirectX::XMFLOAT3A>& input,
+                   const MatrixView<const Sample>& guides, unsigned int x,
+                   unsigned int y, int step, float color_sigma) const;
+
+  unsigned int width_;
+  unsigned int height_;
+  DenoiserSettings settings_;
+  utils::numa::ThreadPool& thread_pool_;
+  // Passes alternate between the two buffers, the first one writes to
+  // `buffers_[0]`.
+  utils::numa::FirstTouchBuffer<DirectX::XMFLOAT3A> buffers_[2];
+};
+}  // namespace ray_tracer
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "../common/matrix_view.h"
+
+namespace ray_tracer {
+// Bilinear sample of `image` at continuous pixel coordinates `(x, y)`, where
+// pixel centers lie at half-integers. Clamps to the border pixels.
+inline DirectX::XMVECTOR SampleBilinear(
+    const MatrixView<DirectX::XMFLOAT3A>& image, float x, float y) {
+  const float max_x = static_cast<float>(image.Columns() - 1);
+  const float max_y = static_cast<float>(image.Rows() - 1);
+  const float clamped_x = std::clamp(x - 0.5f, 0.0f, max_x);
+  const float clamped_y = std::clamp(y - 0.5f, 0.0f, max_y);
+  const auto x0 = static_cast<size_t>(clamped_x);
+  const auto y0 = static_cast<size_t>(clamped_y);
+  const size_t x1 = std::min(x0 + 1, image.Columns() - 1);
+  const size_t y1 = std::min(y0 + 1, image.Rows() - 1);
+  const float weight_x = clamped_x - static_cast<float>(x0);
+  const float weight_y = clamped_y - static_cast<float>(y0);
+
+  const auto top = DirectX::XMVectorLerp(
+      DirectX::XMLoadFloat3A(&image.At(y0, x0)),
+      DirectX::XMLoadFloat3A(&image.At(y0, x1)), weight_x);
+  const auto bottom = DirectX::XMVectorLerp(
+      DirectX::XMLoadFloat3A(&image.At(y1, x0)),
+      DirectX::XMLoadFloat3A(&image.At(y1, x1)), weight_x);
+  return DirectX::XMVectorLerp(top, bottom, weight_y);
+}
+}  // namespace ray_tracer
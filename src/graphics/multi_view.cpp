@@ -0,0 +1,93 @@
+#include "multi_view.h"
+
+#include <cassert>
+
+namespace {
+ray_tracer::View MakeView(DirectX::FXMMATRIX camera_to_world_matrix,
+                          unsigned int width, unsigned int height) {
+  ray_tracer::View view{.camera_to_world_matrix = {},
+                        .width = width,
+                        .height = height};
+  DirectX::XMStoreFloat4x4A(&view.camera_to_world_matrix,
+                            camera_to_world_matrix);
+  return view;
+}
+
+ray_tracer::View MakeCubeMapFace(DirectX::FXMVECTOR position,
+                                 DirectX::FXMVECTOR direction,
+                                 DirectX::FXMVECTOR up, unsigned int size) {
+  return MakeView(
+      DirectX::XMMatrixInverse(
+          nullptr, DirectX::XMMatrixLookToRH(position, direction, up)),
+      size, size);
+}
+}  // namespace
+
+std::array<ray_tracer::View, 2> ray_tracer::MakeStereoViews(
+    DirectX::FXMMATRIX camera_to_world_matrix, float eye_separation,
+    unsigned int width, unsigned int height) {
+  const float half_separation = 0.5f * eye_separation;
+  return {MakeView(DirectX::XMMatrixMultiply(
+                       DirectX::XMMatrixTranslation(-half_separation, 0.0f,
+                                                    0.0f),
+                       camera_to_world_matrix),
+                   width, height),
+          MakeView(DirectX::XMMatrixMultiply(
+                       DirectX::XMMatrixTranslation(half_separation, 0.0f,
+                                                    0.0f),
+                       camera_to_world_matrix),
+                   width, height)};
+}
+
+std::array<ray_tracer::View, 6> ray_tracer::MakeCubeMapViews(
+    DirectX::FXMVECTOR position, unsigned int size) {
+  const DirectX::XMVECTOR x = DirectX::g_XMIdentityR0;
+  const DirectX::XMVECTOR y = DirectX::g_XMIdentityR1;
+  const DirectX::XMVECTOR z = DirectX::g_XMIdentityR2;
+  return {MakeCubeMapFace(position, x, y, size),
+          MakeCubeMapFace(position, DirectX::XMVectorNegate(x), y, size),
+          MakeCubeMapFace(position, y, DirectX::XMVectorNegate(z), size),
+          MakeCubeMapFace(position, DirectX::XMVectorNegate(y), z, size),
+          MakeCubeMapFace(position, z, y, size),
+          MakeCubeMapFace(position, DirectX::XMVectorNegate(z), y, size)};
+}
+
+ray_tracer::MultiViewRenderer::MultiViewRenderer(
+    std::span<const View> views, unsigned int tile_size,
+    utils::numa::ThreadPool& thread_pool)
+    : views_(views.begin(), views.end()),
+      thread_pool_(thread_pool),
+      colors_([&] {
+        size_t pixels = 0;
+        for (const auto& view : views) {
+          pixels += static_cast<size_t>(view.width) * view.height;
+        }
+        return pixels;
+      }()) {
+  row_offsets_.push_back(0);
+  pixel_offsets_.push_back(0);
+  for (const auto& view : views_) {
+    tile_grids_.emplace_back(view.width, view.height, tile_size, thread_pool);
+    row_offsets_.push_back(row_offsets_.back() + view.height);
+    pixel_offsets_.push_back(pixel_offsets_.back() +
+                             static_cast<size_t>(view.width) * view.height);
+  }
+}
+
+void ray_tracer::MultiViewRenderer::SetViews(std::span<const View> views) {
+  assert(views.size() == views_.size());
+  for (size_t view_index = 0; view_index < views.size(); ++view_index) {
+    assert(views[view_index].width == views_[view_index].width &&
+           views[view_index].height == views_[view_index].height);
+    views_[view_index].camera_to_world_matrix =
+        views[view_index].camera_to_world_matrix;
+  }
+}
+
+ray_tracer::MultiViewStats ray_tracer::MultiViewRenderer::GetStats() const {
+  return stats_;
+}
+
+void ray_tracer::MultiViewRenderer::ResetStats() {
+  stats_ = {.views = 0, .pixels = 0, .seconds = 0.0};
+}
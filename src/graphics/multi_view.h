@@ -0,0 +1,141 @@
+#pragma once
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../common/matrix_view.h"
+#include "../utils/numa.h"
+#include "camera_ray.h"
+#include "tile_culling.h"
+
+namespace ray_tracer {
+// A camera and the size of its image. Views share the 90 degree horizontal
+// field of view of `CreateCameraRay`.
+struct View {
+  DirectX::XMFLOAT4X4A camera_to_world_matrix;
+  unsigned int width;
+  unsigned int height;
+};
+
+struct MultiViewStats {
+  // Views and pixels rendered, and seconds spent rendering them, since the
+  // last `ResetStats`.
+  uint64_t views;
+  uint64_t pixels;
+  double seconds;
+};
+
+// Left and right eye, `eye_separation` apart along the x axis of the camera
+// and looking the same way.
+std::array<View, 2> MakeStereoViews(DirectX::FXMMATRIX camera_to_world_matrix,
+                                    float eye_separation, unsigned int width,
+                                    unsigned int height);
+
+// Square faces of a cube map around `position`, looking along +x, -x, +y, -y,
+// +z and -z. The side faces are upright; the top face has -z up and the bottom
+// face +z.
+std::array<View, 6> MakeCubeMapViews(DirectX::FXMVECTOR position,
+                                     unsigned int size);
+
+// Renders several views of the same scene in one pass. The rows of all views
+// go to the thread pool as one job, so the views share a dispatch, the scene
+// the sample function reads and any caches it fills, and the threads that
+// finish one view early pick up rows of another.
+class MultiViewRenderer {
+ public:
+  MultiViewRenderer(std::span<const View> views, unsigned int tile_size,
+                    utils::numa::ThreadPool& thread_pool);
+
+  // Moves the cameras; `views` keep the count and sizes given at
+  // construction.
+  void SetViews(std::span<const View> views);
+
+  inline std::span<const View> Views() const { return views_; }
+
+  // Culls the tiles of every view against `bounds`, then calls
+  // `sample_function(view_index, x, y, direction, origin, mesh_indices)` for
+  // the ray through the center of each pixel, where `mesh_indices` are the
+  // meshes and primitives its tile can hit, and stores the returned color.
+  template <typename SampleFunction>
+  void Render(std::span<const DirectX::BoundingBox> bounds,
+              SampleFunction&& sample_function);
+
+  inline MatrixView<DirectX::XMFLOAT3A> Colors(size_t view_index) {
+    const auto& view = views_[view_index];
+    return MatrixView<DirectX::XMFLOAT3A>(
+        colors_.Elements().subspan(
+            pixel_offsets_[view_index],
+            static_cast<size_t>(view.width) * view.height),
+        view.height, view.width);
+  }
+
+  MultiViewStats GetStats() const;
+
+  void ResetStats();
+
+ private:
+  std::vector<View> views_;
+  std::vector<TileGrid> tile_grids_;
+  // First row of each view among the rows of all views, and its first pixel
+  // in `colors_`, with the totals at the end.
+  std::vector<size_t> row_offsets_;
+  std::vector<size_t> pixel_offsets_;
+  utils::numa::ThreadPool& thread_pool_;
+  MultiViewStats stats_{.views = 0, .pixels = 0, .seconds = 0.0};
+  utils::numa::FirstTouchBuffer<DirectX::XMFLOAT3A> colors_;
+};
+
+template <typename SampleFunction>
+void MultiViewRenderer::Render(std::span<const DirectX::BoundingBox> bounds,
+                               SampleFunction&& sample_function) {
+  const auto start_time = std::chrono::steady_clock::now();
+  for (size_t view_index = 0; view_index < views_.size(); ++view_index) {
+    tile_grids_[view_index].Cull(
+        DirectX::XMLoadFloat4x4A(&views_[view_index].camera_to_world_matrix),
+        bounds);
+  }
+
+  // One row per chunk.
+  thread_pool_.ParallelFor(
+      row_offsets_.back(), 1, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+          const auto view_index = static_cast<size_t>(
+              std::ranges::upper_bound(row_offsets_, row) -
+              row_offsets_.begin() - 1);
+          const auto& view = views_[view_index];
+          const auto& tile_grid = tile_grids_[view_index];
+          const auto camera_to_world_matrix =
+              DirectX::XMLoadFloat4x4A(&view.camera_to_world_matrix);
+          const auto y =
+              static_cast<unsigned int>(row - row_offsets_[view_index]);
+          const size_t row_offset =
+              pixel_offsets_[view_index] + static_cast<size_t>(y) * view.width;
+          for (auto x = 0U; x < view.width; ++x) {
+            DirectX::XMVECTOR origin = {};
+            DirectX::XMVECTOR direction = {};
+            CreateCameraRay(origin, direction, x, y,
+                            static_cast<int>(view.width),
+                            static_cast<int>(view.height),
+                            camera_to_world_matrix);
+            DirectX::XMStoreFloat3A(
+                &colors_[row_offset + x],
+                sample_function(view_index, x, y, direction, origin,
+                                tile_grid.At(x, y).mesh_indices));
+          }
+        }
+      });
+
+  stats_.views += views_.size();
+  stats_.pixels += pixel_offsets_.back();
+  stats_.seconds += std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start_time)
+                        .count();
+}
+}  // namespace ray_tracer
@@ -0,0 +1,126 @@
+#include "path_tracer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../utils/xm.h"
+
+namespace {
+// Offset of ray origins along the normal, so rays do not hit the surface they
+// leave.
+constexpr float kRayOffset = 1.0e-3f;
+// Bounce rays ignore hits closer than this.
+constexpr float kBounceMinDistance = 1.0e-4f;
+// Highest chance of a path to survive Russian roulette, so bright paths end
+// eventually as well.
+constexpr float kMaxSurvival = 0.95f;
+}  // namespace
+
+DirectX::XMVECTOR ray_tracer::TracePath(
+    std::span<const scene::SharedMesh> meshes,
+    std::span<const scene::Primitive> primitives,
+    std::span<const DirectX::XMFLOAT3A> light_positions,
+    AlbedoFunction albedo_function, const PathTracerSettings& settings,
+    DirectX::FXMVECTOR world_direction, DirectX::FXMVECTOR world_origin,
+    PathRandom& random, uint64_t& out_rays) {
+  auto radiance = DirectX::XMVectorZero();
+  DirectX::XMVECTOR throughput = DirectX::g_XMOne;
+  auto origin = world_origin;
+  auto direction = world_direction;
+  for (auto bounce = 0U;; ++bounce) {
+    ++out_rays;
+    const auto hit =
+        bounce == 0
+            ? FindClosestHit(meshes, primitives, direction, origin)
+            : FindClosestHit(meshes, primitives, direction, origin,
+                             kBounceMinDistance);
+    if (!hit.has_value()) {
+      radiance = DirectX::XMVectorMultiplyAdd(
+          throughput, DirectX::XMVectorReplicate(settings.sky_radiance),
+          radiance);
+      break;
+    }
+
+    const auto point = utils::xm::ray::At(origin, direction, hit->distance);
+    auto normal = GetHitNormal(meshes, primitives, *hit, direction, origin);
+    if (DirectX::XMVectorGetX(DirectX::XMVector3Dot(normal, direction)) >
+        0.0f) {
+      normal = DirectX::XMVectorNegate(normal);
+    }
+    const auto albedo = albedo_function(*hit, direction, origin, bounce);
+    const auto offset_point = DirectX::XMVectorMultiplyAdd(
+        normal, DirectX::XMVectorReplicate(kRayOffset), point);
+
+    // Direct light of every point light through a Lambertian BRDF,
+    // `albedo / pi`.
+    for (const auto& light_position : light_positions) {
+      const auto to_light = DirectX::XMVectorSubtract(
+          utils::xm::float3a::Load(light_position), point);
+      const float distance_squared =
+          DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(to_light));
+      const float distance = std::sqrt(distance_squared);
+      const auto light_direction =
+          DirectX::XMVectorScale(to_light, 1.0f / distance);
+      const float cosine = DirectX::XMVectorGetX(
+          DirectX::XMVector3Dot(normal, light_direction));
+      if (cosine <= 0.0f) {
+        continue;
+      }
+      ++out_rays;
+      if (IsOccluded(meshes, primitives, offset_point, light_direction,
+                     distance)) {
+        continue;
+      }
+      radiance = DirectX::XMVectorMultiplyAdd(
+          DirectX::XMVectorMultiply(throughput, albedo),
+          DirectX::XMVectorReplicate(
+              settings.light_intensity * cosine /
+              (DirectX::XM_PI * distance_squared)),
+          radiance);
+    }
+
+    if (bounce == settings.max_bounces) {
+      break;
+    }
+    throughput = DirectX::XMVectorMultiply(throughput, albedo);
+    if (bounce >= settings.roulette_bounces) {
+      DirectX::XMFLOAT3 weights{};
+      DirectX::XMStoreFloat3(&weights, throughput);
+      const float survival = std::min(
+          std::max({weights.x, weights.y, weights.z}), kMaxSurvival);
+      if (random.Next() >= survival) {
+        break;
+      }
+      throughput = DirectX::XMVectorScale(throughput, 1.0f / survival);
+    }
+
+    const float u = random.Next();
+    const float v = random.Next();
+    direction = utils::xm::hemisphere::SampleCosine(normal, u, v);
+    origin = offset_point;
+  }
+  return radiance;
+}
+
+ray_tracer::PathTracer::PathTracer(unsigned int width, unsigned int height,
+                                   const PathTracerSettings& settings,
+                                   utils::numa::ThreadPool& thread_pool)
+    : width_(width),
+      height_(height),
+      settings_(settings),
+      thread_pool_(thread_pool),
+      sums_(static_cast<size_t>(width) * height),
+      colors_(sums_.size()) {}
+
+ray_tracer::PathTracerStats ray_tracer::PathTracer::GetStats() const {
+  return {.samples_per_pixel = samples_per_pixel_,
+          .paths = paths_,
+          .rays = rays_.load(std::memory_order_relaxed),
+          .seconds = seconds_};
+}
+
+void ray_tracer::PathTracer::ResetStats() {
+  paths_ = 0;
+  rays_.store(0, std::memory_order_relaxed);
+  seconds_ = 0.0;
+}
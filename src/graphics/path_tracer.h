@@ -0,0 +1,174 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+
+#include "../common/function_ref.h"
+#include "../common/matrix_view.h"
+#include "../scene/mesh.h"
+#include "../scene/primitive.h"
+#include "../utils/numa.h"
+#include "ray_tracer.h"
+
+namespace ray_tracer {
+struct PathTracerSettings {
+  // Paths traced through each pixel per frame.
+  unsigned int samples_per_frame;
+  // Diffuse bounces after the camera ray. From `roulette_bounces` on, paths
+  // end at random in proportion to how little light they still carry.
+  unsigned int max_bounces;
+  unsigned int roulette_bounces;
+  // Radiant intensity of each point light.
+  float light_intensity;
+  // Radiance of rays that leave the scene.
+  float sky_radiance;
+};
+
+struct PathTracerStats {
+  // Paths accumulated per pixel since the last `Reset`.
+  uint32_t samples_per_pixel;
+  // Paths and rays traced, and seconds spent tracing, since the last
+  // `ResetStats`.
+  uint64_t paths;
+  uint64_t rays;
+  double seconds;
+};
+
+// Counter-based random numbers: number `n` of a path is a hash of its pixel,
+// its sample index and `n`, so the numbers do not depend on which thread
+// traces a path or in which order.
+class PathRandom {
+ public:
+  inline PathRandom(uint32_t pixel_index, uint32_t sample_index)
+      : key_(Mix((static_cast<uint64_t>(sample_index) << 32U) | pixel_index)) {
+  }
+
+  // Uniform in [0, 1).
+  inline float Next() {
+    ++counter_;
+    return static_cast<float>(Mix(key_ + counter_ * 0x9E3779B97F4A7C15ULL) >>
+                              40U) *
+           0x1.0p-24f;
+  }
+
+ private:
+  // Finalizer of SplitMix64.
+  static inline uint64_t Mix(uint64_t z) {
+    z = (z ^ (z >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27U)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31U);
+  }
+
+  uint64_t key_;
+  uint64_t counter_ = 0;
+};
+
+// Surface color of a hit of the ray with the given direction and origin, after
+// the given number of bounces, 0 for the camera ray.
+using AlbedoFunction = FunctionRef<DirectX::XMVECTOR(
+    const Hit&, DirectX::FXMVECTOR, DirectX::FXMVECTOR, unsigned int)>;
+
+// Radiance arriving along a camera ray over a path of Lambertian bounces. At
+// every hit the point lights are sampled directly through shadow rays
+// (next-event estimation), then the path continues in a cosine distributed
+// direction, which leaves only the albedo in its throughput. Adds the rays
+// traced to `out_rays`.
+DirectX::XMVECTOR TracePath(std::span<const scene::SharedMesh> meshes,
+                            std::span<const scene::Primitive> primitives,
+                            std::span<const DirectX::XMFLOAT3A> light_positions,
+                            AlbedoFunction albedo_function,
+                            const PathTracerSettings& settings,
+                            DirectX::FXMVECTOR world_direction,
+                            DirectX::FXMVECTOR world_origin,
+                            PathRandom& random, uint64_t& out_rays);
+
+// Progressive path tracing: every frame adds paths through each pixel to
+// running averages until `Reset`, e.g. after the camera moved. Rows are traced
+// by `thread_pool`, and each path draws its own random numbers. The image still
+// depends on when streamed geometry arrives, so callers reset whenever it
+// changes, and sample textures without falling back to resident levels.
+class PathTracer {
+ public:
+  PathTracer(unsigned int width, unsigned int height,
+             const PathTracerSettings& settings,
+             utils::numa::ThreadPool& thread_pool);
+
+  // Drops the accumulated paths.
+  inline void Reset() { samples_per_pixel_ = 0; }
+
+  // `path_function(x, y, offset_x, offset_y, random, rays)` traces a path
+  // through the given position inside pixel `(x, y)`, adds the rays it traced
+  // to `rays` and returns the radiance.
+  template <typename PathFunction>
+  void Render(PathFunction&& path_function);
+
+  // Averages of the accumulated paths, clamped to the displayable range.
+  inline MatrixView<DirectX::XMFLOAT3A> Colors() {
+    return MatrixView<DirectX::XMFLOAT3A>(colors_.Elements(), height_, width_);
+  }
+
+  inline const PathTracerSettings& GetSettings() const { return settings_; }
+
+  PathTracerStats GetStats() const;
+
+  void ResetStats();
+
+ private:
+  unsigned int width_;
+  unsigned int height_;
+  PathTracerSettings settings_;
+  utils::numa::ThreadPool& thread_pool_;
+  uint32_t samples_per_pixel_ = 0;
+  uint64_t paths_ = 0;
+  std::atomic<uint64_t> rays_ = 0;
+  double seconds_ = 0.0;
+  utils::numa::FirstTouchBuffer<DirectX::XMFLOAT3A> sums_;
+  utils::numa::FirstTouchBuffer<DirectX::XMFLOAT3A> colors_;
+};
+
+template <typename PathFunction>
+void PathTracer::Render(PathFunction&& path_function) {
+  const auto start_time = std::chrono::steady_clock::now();
+  const uint32_t first_sample = samples_per_pixel_;
+  const uint32_t end_sample = first_sample + settings_.samples_per_frame;
+  const float inverse_samples = 1.0f / static_cast<float>(end_sample);
+
+  // One row per chunk.
+  thread_pool_.ParallelFor(
+      sums_.size(), width_, [&](size_t begin, size_t end) {
+        uint64_t rays = 0;
+        for (size_t pixel_index = begin; pixel_index < end; ++pixel_index) {
+          const auto x = static_cast<unsigned int>(pixel_index % width_);
+          const auto y = static_cast<unsigned int>(pixel_index / width_);
+          auto sum = first_sample == 0
+                         ? DirectX::g_XMZero
+                         : DirectX::XMLoadFloat3A(&sums_[pixel_index]);
+          for (uint32_t sample_index = first_sample; sample_index < end_sample;
+               ++sample_index) {
+            auto random =
+                PathRandom(static_cast<uint32_t>(pixel_index), sample_index);
+            const float offset_x = random.Next();
+            const float offset_y = random.Next();
+            sum = DirectX::XMVectorAdd(
+                sum, path_function(x, y, offset_x, offset_y, random, rays));
+          }
+          DirectX::XMStoreFloat3A(&sums_[pixel_index], sum);
+          DirectX::XMStoreFloat3A(
+              &colors_[pixel_index],
+              DirectX::XMVectorSaturate(
+                  DirectX::XMVectorScale(sum, inverse_samples)));
+        }
+        rays_.fetch_add(rays, std::memory_order_relaxed);
+      });
+
+  samples_per_pixel_ = end_sample;
+  paths_ += sums_.size() * settings_.samples_per_frame;
+  seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start_time)
+                  .count();
+}
+}  // namespace ray_tracer
@@ -0,0 +1,45 @@
+#include "quality_controller.h"
+
+#include <cassert>
+#include <utility>
+
+ray_tracer::QualityController::QualityController(
+    const QualityControllerSettings& settings,
+    std::vector<QualityLevel> levels)
+    : settings_(settings), levels_(std::move(levels)) {
+  assert(!levels_.empty());
+  stats_.average_frame_time = settings_.target_frame_time;
+}
+
+bool ray_tracer::QualityController::Update(float frame_time) {
+  stats_.last_frame_time = frame_time;
+  stats_.average_frame_time +=
+      settings_.smoothing * (frame_time - stats_.average_frame_time);
+
+  const bool overrun =
+      frame_time > settings_.target_frame_time * settings_.overrun_threshold;
+  if (++frames_since_change_ < settings_.cooldown_frames && !overrun) {
+    return false;
+  }
+
+  const size_t previous_index = level_index_;
+  if ((overrun || stats_.average_frame_time > settings_.target_frame_time) &&
+      level_index_ + 1 < levels_.size()) {
+    ++level_index_;
+    ++stats_.downgrades;
+  } else if (stats_.average_frame_time <
+                 settings_.target_frame_time * settings_.upgrade_threshold &&
+             level_index_ > 0) {
+    --level_index_;
+    ++stats_.upgrades;
+  }
+  if (level_index_ == previous_index) {
+    return false;
+  }
+
+  // The average still reflects the old level; start over from the target.
+  stats_.average_frame_time = settings_.target_frame_time;
+  stats_.level_index = level_index_;
+  frames_since_change_ = 0;
+  return true;
+}
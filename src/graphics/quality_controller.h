@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace ray_tracer {
+// One step of the quality ladder.
+struct QualityLevel {
+  // Internal resolution relative to the output resolution.
+  float resolution_scale;
+  // Samples of anti-aliased edge pixels, first sample included.
+  unsigned int max_samples_per_pixel;
+  // Average camera rays per pixel the adaptive sampler may spend.
+  float rays_per_pixel;
+  // 0: primary rays only, 1: plus shadow rays, 2: plus reflection rays.
+  unsigned int secondary_depth;
+};
+
+struct QualityControllerSettings {
+  // Render time per frame to hold, in milliseconds.
+  float target_frame_time;
+  // Step up once the average is below this fraction of the target.
+  float upgrade_threshold;
+  // Step down right away, without waiting for the average or the cooldown,
+  // once a single frame takes longer than this multiple of the target.
+  float overrun_threshold;
+  // Weight of the newest frame in the running average.
+  float smoothing;
+  // Frames to wait after a change before deciding again.
+  unsigned int cooldown_frames;
+};
+
+struct QualityControllerStats {
+  float last_frame_time;
+  float average_frame_time;
+  size_t level_index;
+  size_t downgrades;
+  size_t upgrades;
+};
+
+// Picks the best quality level whose render time stays within the target.
+// Decisions follow a running average of the frame time and wait a few frames
+// after each change, except that a frame far over the target steps down at
+// once; stepping up needs headroom.
+class QualityController {
+ public:
+  // `levels` are ordered from the best to the cheapest.
+  QualityController(const QualityControllerSettings& settings,
+                    std::vector<QualityLevel> levels);
+
+  // Feed the render time of the last frame. Returns whether the level changed.
+  bool Update(float frame_time);
+
+  inline const QualityLevel& GetLevel() const { return levels_[level_index_]; }
+
+  inline std::span<const QualityLevel> Levels() const { return levels_; }
+
+  inline const QualityControllerStats& GetStats() const { return stats_; }
+
+ private:
+  QualityControllerSettings settings_;
+  std::vector<QualityLevel> levels_;
+  size_t level_index_ = 0;
+  unsigned int frames_since_change_ = 0;
+  QualityControllerStats stats_{};
+};
+}  // namespace ray_tracer
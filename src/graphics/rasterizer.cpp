@@ -0,0 +1,321 @@
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
+#include "../utils/frame_arena.h"
+#include "camera_ray.h"
+
+namespace {
+// Faces set up per task of the thread pool.
+constexpr size_t kSetupChunkSize = 256;
+
+// Vertex of a face clipped against the near plane.
+struct ClipVertex {
+  DirectX::XMFLOAT3 position;
+  DirectX::XMFLOAT2 barycentrics;
+};
+
+inline ClipVertex Lerp(const ClipVertex& a, const ClipVertex& b, float t) {
+  return {{std::lerp(a.position.x, b.position.x, t),
+           std::lerp(a.position.y, b.position.y, t),
+           std::lerp(a.position.z, b.position.z, t)},
+          {std::lerp(a.barycentrics.x, b.barycentrics.x, t),
+           std::lerp(a.barycentrics.y, b.barycentrics.y, t)}};
+}
+
+// Keep the part of a triangle with `w = -z >= near_plane` (Sutherland-Hodgman
+// against a single plane), which is a triangle or a quad.
+inline size_t ClipAgainstNearPlane(std::array<ClipVertex, 4>& out_polygon,
+                                   const std::array<ClipVertex, 3>& triangle,
+                                   float near_plane) {
+  size_t count = 0;
+  for (size_t i = 0; i < triangle.size(); ++i) {
+    const auto& current = triangle[i];
+    const auto& next = triangle[(i + 1) % triangle.size()];
+    const float current_distance = -current.position.z - near_plane;
+    const float next_distance = -next.position.z - near_plane;
+
+    if (current_distance >= 0.0f) {
+      out_polygon[count++] = current;
+    }
+    if ((current_distance >= 0.0f) != (next_distance >= 0.0f)) {
+      const float t = current_distance / (current_distance - next_distance);
+      out_polygon[count++] = Lerp(current, next, t);
+    }
+  }
+  return count;
+}
+
+// Twice the signed area of the triangle `(a, b, p)`.
+inline float EdgeFunction(const DirectX::XMFLOAT2& a,
+                          const DirectX::XMFLOAT2& b, float p_x, float p_y) {
+  return (b.x - a.x) * (p_y - a.y) - (b.y - a.y) * (p_x - a.x);
+}
+}  // namespace
+
+ray_tracer::Rasterizer::Rasterizer(unsigned int width, unsigned int height,
+                                   unsigned int tile_size,
+                                   utils::numa::ThreadPool& thread_pool)
+    : width_(width),
+      height_(height),
+      thread_pool_(thread_pool),
+      hits_(height, width, ImageLayout::kTiled, tile_size) {
+  // The camera plane is an affine function of the pixel position, so two
+  // corners are enough to invert it.
+  const auto top_left = GetCameraPlanePoint(0.0f, 0.0f, static_cast<int>(width),
+                                            static_cast<int>(height));
+  const auto bottom_right = GetCameraPlanePoint(
+      static_cast<float>(width), static_cast<float>(height),
+      static_cast<int>(width), static_cast<int>(height));
+  plane_origin_ = top_left;
+  plane_to_pixel_scale_ = {
+      static_cast<float>(width) / (bottom_right.x - top_left.x),
+      static_cast<float>(height) / (bottom_right.y - top_left.y)};
+
+  // Hits closer than 1 along a unit direction are rejected by the tracer, so
+  // the near plane may sit at the depth of that distance along the widest ray.
+  const float max_x =
+      std::fmaxf(std::abs(top_left.x), std::abs(bottom_right.x));
+  const float max_y =
+      std::fmaxf(std::abs(top_left.y), std::abs(bottom_right.y));
+  near_plane_ = 0.99f / std::sqrt(max_x * max_x + max_y * max_y + 1.0f);
+}
+
+void ray_tracer::Rasterizer::SetupFace(
+    FaceSetup& setup, const scene::Mesh& mesh,
+    DirectX::FXMMATRIX world_to_camera_matrix, uint32_t mesh_index,
+    uint32_t face_index) const {
+  setup.triangle_count = 0;
+
+  DirectX::XMVECTOR vertex_a{};
+  DirectX::XMVECTOR vertex_b{};
+  DirectX::XMVECTOR vertex_c{};
+  utils::xm::triangle::Load(vertex_a, vertex_b, vertex_c, mesh.first,
+                            mesh.second[face_index]);
+
+  std::array<ClipVertex, 3> triangle = {
+      ClipVertex{{}, {0.0f, 0.0f}}, ClipVertex{{}, {1.0f, 0.0f}},
+      ClipVertex{{}, {0.0f, 1.0f}}};
+  DirectX::XMStoreFloat3(
+      &triangle[0].position,
+      DirectX::XMVector3Transform(vertex_a, world_to_camera_matrix));
+  DirectX::XMStoreFloat3(
+      &triangle[1].position,
+      DirectX::XMVector3Transform(vertex_b, world_to_camera_matrix));
+  DirectX::XMStoreFloat3(
+      &triangle[2].position,
+      DirectX::XMVector3Transform(vertex_c, world_to_camera_matrix));
+
+  std::array<ClipVertex, 4> polygon{};
+  const size_t vertex_count =
+      ClipAgainstNearPlane(polygon, triangle, near_plane_);
+
+  // Fan-triangulate the clipped polygon.
+  for (size_t i = 2; i < vertex_count; ++i) {
+    const std::array<const ClipVertex*, 3> corners = {&polygon[0],
+                                                      &polygon[i - 1],
+                                                      &polygon[i]};
+    auto& raster_triangle = setup.triangles[setup.triangle_count];
+    for (size_t corner = 0; corner < corners.size(); ++corner) {
+      const auto& vertex = *corners[corner];
+      const float inverse_w = -1.0f / vertex.position.z;
+      raster_triangle.face_vertices[corner] = triangle[corner].position;
+      raster_triangle.positions[corner] = {
+          (vertex.position.x * inverse_w - plane_origin_.x) *
+              plane_to_pixel_scale_.x,
+          (vertex.position.y * inverse_w - plane_origin_.y) *
+              plane_to_pixel_scale_.y};
+      raster_triangle.inverse_w[corner] = inverse_w;
+      raster_triangle.barycentrics[corner] = vertex.barycentrics;
+    }
+
+    const auto& p = raster_triangle.positions;
+    const float area = EdgeFunction(p[0], p[1], p[2].x, p[2].y);
+    if (std::abs(area) < utils::xm::scalar::kEpsilon) {
+      continue;
+    }
+    raster_triangle.inverse_area = 1.0f / area;
+    raster_triangle.min_x = std::fminf(p[0].x, std::fminf(p[1].x, p[2].x));
+    raster_triangle.min_y = std::fminf(p[0].y, std::fminf(p[1].y, p[2].y));
+    raster_triangle.max_x = std::fmaxf(p[0].x, std::fmaxf(p[1].x, p[2].x));
+    raster_triangle.max_y = std::fmaxf(p[0].y, std::fmaxf(p[1].y, p[2].y));
+    raster_triangle.mesh_index = mesh_index;
+    raster_triangle.face_index = face_index;
+    ++setup.triangle_count;
+  }
+}
+
+void ray_tracer::Rasterizer::RasterizeTile(const Tile& tile,
+                                           std::span<const uint32_t> bin) {
+  for (auto y = tile.y; y < tile.y + tile.height; ++y) {
+    for (auto x = tile.x; x < tile.x + tile.width; ++x) {
+      const float sample_x = static_cast<float>(x) + 0.5f;
+      const float sample_y = static_cast<float>(y) + 0.5f;
+      Hit closest_hit{.distance = std::numeric_limits<float>::infinity(),
+                      .beta = 0.0f,
+                      .gamma = 0.0f,
+                      .mesh_index = kNoMesh,
+                      .face_index = 0};
+
+      for (const auto triangle_index : bin) {
+        const auto& triangle = triangles_[triangle_index];
+        if (sample_x < triangle.min_x || sample_x > triangle.max_x ||
+            sample_y < triangle.min_y || sample_y > triangle.max_y) {
+          continue;
+        }
+
+        // Screen space barycentrics; faces are double-sided like in the
+        // tracer, so the sign of the area does not matter.
+        const auto& p = triangle.positions;
+        const float lambda_0 = EdgeFunction(p[1], p[2], sample_x, sample_y) *
+                               triangle.inverse_area;
+        const float lambda_1 = EdgeFunction(p[2], p[0], sample_x, sample_y) *
+                               triangle.inverse_area;
+        const float lambda_2 = 1.0f - lambda_0 - lambda_1;
+        if (lambda_0 < 0.0f || lambda_1 < 0.0f || lambda_2 < 0.0f) {
+          continue;
+        }
+
+        // Perspective-correct barycentrics of the original face.
+        const float q_0 = lambda_0 * triangle.inverse_w[0];
+        const float q_1 = lambda_1 * triangle.inverse_w[1];
+        const float q_2 = lambda_2 * triangle.inverse_w[2];
+        const float inverse_sum = 1.0f / (q_0 + q_1 + q_2);
+        const auto& b = triangle.barycentrics;
+        const float beta =
+            (q_0 * b[0].x + q_1 * b[1].x + q_2 * b[2].x) * inverse_sum;
+        const float gamma =
+            (q_0 * b[0].y + q_1 * b[1].y + q_2 * b[2].y) * inverse_sum;
+
+        // Distance from the camera to the point on the face.
+        const auto& v = triangle.face_vertices;
+        const float alpha = 1.0f - beta - gamma;
+        const float point_x = alpha * v[0].x + beta * v[1].x + gamma * v[2].x;
+        const float point_y = alpha * v[0].y + beta * v[1].y + gamma * v[2].y;
+        const float point_z = alpha * v[0].z + beta * v[1].z + gamma * v[2].z;
+        const float distance = std::sqrt(
+            point_x * point_x + point_y * point_y + point_z * point_z);
+
+        if (distance > 1.0f && distance < closest_hit.distance) {
+          closest_hit = {.distance = distance,
+                         .beta = beta,
+                         .gamma = gamma,
+                         .mesh_index = triangle.mesh_index,
+                         .face_index = triangle.face_index};
+        }
+      }
+
+      hits_.At(y, x) = closest_hit;
+    }
+  }
+}
+
+void ray_tracer::Rasterizer::Render(std::span<const scene::SharedMesh> meshes,
+                                    DirectX::FXMMATRIX world_to_camera_matrix,
+                                    const TileGrid& tile_grid) {
+  // Set up all faces in parallel.
+  size_t face_count = 0;
+  for (const auto& mesh : meshes) {
+    face_count += mesh->second.size();
+  }
+  const auto faces =
+      utils::memory::AllocateFrameArray<DirectX::XMUINT2>(face_count);
+  size_t face_number = 0;
+  for (size_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index) {
+    for (size_t face_index = 0; face_index < meshes[mesh_index]->second.size();
+         ++face_index) {
+      faces[face_number++] = {static_cast<uint32_t>(mesh_index),
+                              static_cast<uint32_t>(face_index)};
+    }
+  }
+  const auto setups = utils::memory::AllocateFrameArray<FaceSetup>(face_count);
+  thread_pool_.ParallelFor(
+      face_count, kSetupChunkSize, [&](size_t begin, size_t end) {
+        for (size_t face_number = begin; face_number < end; ++face_number) {
+          const auto& face = faces[face_number];
+          SetupFace(setups[face_number], *meshes[face.x],
+                    world_to_camera_matrix, face.x, face.y);
+        }
+      });
+
+  // Bin the triangles into every tile their pixel centers can fall into:
+  // count the triangles of each tile, then fill the bins at the running sums.
+  const auto tiles = tile_grid.Tiles();
+  const unsigned int tile_size = tile_grid.TileSize();
+  assert(tile_size == hits_.TileSize());
+  const unsigned int columns = (width_ + tile_size - 1) / tile_size;
+  const auto triangles =
+      utils::memory::AllocateFrameArray<RasterTriangle>(2 * face_count);
+  // First column, first row, last column and last row of the covered tiles.
+  const auto tile_ranges =
+      utils::memory::AllocateFrameArray<DirectX::XMUINT4>(2 * face_count);
+  const auto bin_offsets =
+      utils::memory::AllocateFrameArray<uint32_t>(tiles.size() + 1);
+  std::fill(bin_offsets.begin(), bin_offsets.end(), 0U);
+  size_t triangle_count = 0;
+
+  for (const auto& setup : setups) {
+    for (size_t i = 0; i < setup.triangle_count; ++i) {
+      const auto& triangle = setup.triangles[i];
+      const float max_x = static_cast<float>(width_) - 1.0f;
+      const float max_y = static_cast<float>(height_) - 1.0f;
+      const float first_x = std::ceil(triangle.min_x - 0.5f);
+      const float first_y = std::ceil(triangle.min_y - 0.5f);
+      const float last_x = std::floor(triangle.max_x - 0.5f);
+      const float last_y = std::floor(triangle.max_y - 0.5f);
+      if (first_x > max_x || first_y > max_y || last_x < 0.0f ||
+          last_y < 0.0f || first_x > last_x || first_y > last_y) {
+        continue;
+      }
+
+      tile_ranges[triangle_count] = {
+          static_cast<unsigned int>(std::fmaxf(first_x, 0.0f)) / tile_size,
+          static_cast<unsigned int>(std::fmaxf(first_y, 0.0f)) / tile_size,
+          static_cast<unsigned int>(std::fminf(last_x, max_x)) / tile_size,
+          static_cast<unsigned int>(std::fminf(last_y, max_y)) / tile_size};
+      const auto& range = tile_ranges[triangle_count];
+      triangles[triangle_count++] = triangle;
+      for (auto row = range.y; row <= range.w; ++row) {
+        for (auto column = range.x; column <= range.z; ++column) {
+          ++bin_offsets[static_cast<size_t>(row) * columns + column + 1];
+        }
+      }
+    }
+  }
+
+  for (size_t tile_number = 1; tile_number < bin_offsets.size();
+       ++tile_number) {
+    bin_offsets[tile_number] += bin_offsets[tile_number - 1];
+  }
+  const auto bin_ends =
+      utils::memory::AllocateFrameArray<uint32_t>(tiles.size());
+  std::copy_n(bin_offsets.begin(), tiles.size(), bin_ends.begin());
+  const auto binned_triangles =
+      utils::memory::AllocateFrameArray<uint32_t>(bin_offsets.back());
+  for (uint32_t triangle_index = 0; triangle_index < triangle_count;
+       ++triangle_index) {
+    const auto& range = tile_ranges[triangle_index];
+    for (auto row = range.y; row <= range.w; ++row) {
+      for (auto column = range.x; column <= range.z; ++column) {
+        binned_triangles[bin_ends[static_cast<size_t>(row) * columns +
+                                  column]++] = triangle_index;
+      }
+    }
+  }
+  triangles_ = triangles.first(triangle_count);
+
+  // Rasterize the tiles in parallel; each tile owns its pixels.
+  thread_pool_.ParallelFor(
+      tiles.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t tile_number = begin; tile_number < end; ++tile_number) {
+          RasterizeTile(tiles[tile_number],
+                        binned_triangles.subspan(
+                            bin_offsets[tile_number],
+                            bin_offsets[tile_number + 1] -
+                                bin_offsets[tile_number]));
+        }
+      });
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+
+#include "../common/image.h"
+#include "../scene/mesh.h"
+#include "../utils/numa.h"
+#include "ray_tracer.h"
+#include "tile_culling.h"
+
+namespace ray_tracer {
+// Software rasterizer that resolves the primary hit of every pixel center into
+// a visibility buffer, so that shading can skip the camera ray traversal. The
+// buffer is stored in tiles of the tile grid, so threads rasterizing adjacent
+// tiles never write to the same cache line.
+class Rasterizer {
+ public:
+  Rasterizer(unsigned int width, unsigned int height, unsigned int tile_size,
+             utils::numa::ThreadPool& thread_pool);
+
+  // Bin the faces of `meshes` into the tiles of `tile_grid`, whose tile size
+  // has to match the one given to the constructor, and rasterize the tiles in
+  // parallel on the thread pool.
+  void Render(std::span<const scene::SharedMesh> meshes,
+              DirectX::FXMMATRIX world_to_camera_matrix,
+              const TileGrid& tile_grid);
+
+  // Primary hit through the center of pixel `(x, y)`, the same one
+  // `FindClosestHit` would return for that camera ray.
+  inline std::optional<Hit> At(unsigned int x, unsigned int y) const {
+    const auto& hit = hits_.At(y, x);
+    if (hit.mesh_index == kNoMesh) {
+      return std::nullopt;
+    }
+    return hit;
+  }
+
+ private:
+  static constexpr uint32_t kNoMesh = std::numeric_limits<uint32_t>::max();
+
+  // Screen space triangle, a face or a part of a face clipped at the near
+  // plane.
+  struct RasterTriangle {
+    // Camera space vertices of the original face.
+    DirectX::XMFLOAT3 face_vertices[3];
+    DirectX::XMFLOAT2 positions[3];
+    float inverse_w[3];
+    // `beta` and `gamma` of each vertex with respect to the original face.
+    DirectX::XMFLOAT2 barycentrics[3];
+    float inverse_area;
+    float min_x;
+    float min_y;
+    float max_x;
+    float max_y;
+    uint32_t mesh_index;
+    uint32_t face_index;
+  };
+
+  // Up to two triangles per face, the second one only if clipping produced a
+  // quad.
+  struct FaceSetup {
+    RasterTriangle triangles[2];
+    uint32_t triangle_count;
+  };
+
+  void SetupFace(FaceSetup& setup, const scene::Mesh& mesh,
+                 DirectX::FXMMATRIX world_to_camera_matrix,
+                 uint32_t mesh_index, uint32_t face_index) const;
+
+  void RasterizeTile(const Tile& tile, std::span<const uint32_t> bin);
+
+  unsigned int width_;
+  unsigned int height_;
+  utils::numa::ThreadPool& thread_pool_;
+  // Pixel position = (camera plane position - origin) * scale.
+  DirectX::XMFLOAT2 plane_origin_;
+  DirectX::XMFLOAT2 plane_to_pixel_scale_;
+  float near_plane_;
+  // Triangles of the last `Render`, in the frame arena of its thread.
+  std::span<const RasterTriangle> triangles_;
+  Image<Hit> hits_;
+};
+}  // namespace ray_tracer
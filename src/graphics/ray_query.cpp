@@ -0,0 +1,249 @@
+#include "ray_query.h"
+
+#include <DirectXCollision.h>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <optional>
+#include <utility>
+
+#include "../utils/trace.h"
+
+namespace {
+// Rays per pool job; the pool runs one job at a time, so render jobs wait for
+// at most one of these.
+constexpr size_t kRaysPerJob = size_t{1} << 16;
+// Rays per chunk of a job, a multiple of the 64 occlusion bits per word, so
+// every word is written by one worker.
+constexpr size_t kRaysPerChunk = 256;
+
+// Origin and unit direction of ray `index`.
+inline void LoadRay(DirectX::XMVECTOR& out_origin,
+                    DirectX::XMVECTOR& out_direction,
+                    const ray_tracer::RayBatch& rays, size_t index) {
+  out_origin = DirectX::XMVectorSet(rays.origin_x[index], rays.origin_y[index],
+                                    rays.origin_z[index], 0.0f);
+  out_direction = DirectX::XMVector3Normalize(
+      DirectX::XMVectorSet(rays.direction_x[index], rays.direction_y[index],
+                           rays.direction_z[index], 0.0f));
+}
+
+// Closest hit within `[min_distance, max_distance]`, or any hit if
+// `any_hit`. Meshes and primitives whose bounds the ray misses, or enters
+// beyond the closest hit so far, are skipped.
+inline ray_tracer::Hit Intersect(const scene::SceneGeometry& geometry,
+                                 DirectX::FXMVECTOR origin,
+                                 DirectX::FXMVECTOR direction,
+                                 float min_distance, float max_distance,
+                                 bool any_hit) {
+  auto closest_hit = ray_tracer::Hit{.distance = max_distance,
+                                     .beta = 0.0f,
+                                     .gamma = 0.0f,
+                                     .mesh_index = ray_tracer::kNoHit,
+                                     .face_index = ray_tracer::kNoHit};
+  for (size_t mesh_index = 0; mesh_index < geometry.meshes.size();
+       ++mesh_index) {
+    float bounds_distance = 0.0f;
+    if (!geometry.bounds[mesh_index].Intersects(origin, direction,
+                                                bounds_distance) ||
+        bounds_distance > closest_hit.distance) {
+      continue;
+    }
+
+    const auto& mesh = *geometry.meshes[mesh_index];
+    for (size_t face_index = 0; face_index < mesh.second.size();
+         ++face_index) {
+      DirectX::XMVECTOR vertex_a{};
+      DirectX::XMVECTOR vertex_b{};
+      DirectX::XMVECTOR vertex_c{};
+      utils::xm::triangle::Load(vertex_a, vertex_b, vertex_c, mesh.first,
+                                mesh.second[face_index]);
+      const auto intersection = utils::xm::triangle::Intersect(
+          vertex_a, vertex_b, vertex_c, origin, direction);
+      if (!intersection.has_value() || intersection->z < min_distance ||
+          intersection->z > closest_hit.distance) {
+        continue;
+      }
+
+      closest_hit = ray_tracer::Hit{
+          .distance = intersection->z,
+          .beta = intersection->x,
+          .gamma = intersection->y,
+          .mesh_index = static_cast<uint32_t>(mesh_index),
+          .face_index = static_cast<uint32_t>(face_index)};
+      if (any_hit) {
+        return closest_hit;
+      }
+    }
+  }
+
+  const size_t mesh_count = geometry.meshes.size();
+  std::optional<size_t> closest_primitive{};
+  for (size_t primitive_index = 0;
+       primitive_index < geometry.primitives.size(); ++primitive_index) {
+    float bounds_distance = 0.0f;
+    if (!geometry.bounds[mesh_count + primitive_index].Intersects(
+            origin, direction, bounds_distance) ||
+        bounds_distance > closest_hit.distance) {
+      continue;
+    }
+
+    const auto distance =
+        scene::IntersectPrimitive(geometry.primitives[primitive_index], origin,
+                                  direction, min_distance);
+    if (!distance.has_value() || *distance > closest_hit.distance) {
+      continue;
+    }
+
+    closest_hit.distance = *distance;
+    closest_primitive = primitive_index;
+    if (any_hit) {
+      break;
+    }
+  }
+  if (closest_primitive.has_value()) {
+    closest_hit =
+        ray_tracer::MakePrimitiveHit(geometry.primitives, mesh_count,
+                                     *closest_primitive, closest_hit.distance,
+                                     direction, origin);
+  }
+
+  if (closest_hit.mesh_index == ray_tracer::kNoHit) {
+    closest_hit.distance = std::numeric_limits<float>::infinity();
+  }
+  return closest_hit;
+}
+
+// Call `function(begin, end)` for chunks of `[0, count)` on the pool, one job
+// of at most `kRaysPerJob` rays at a time.
+template <typename Function>
+void ForEachRayChunk(utils::numa::ThreadPool& thread_pool, size_t count,
+                     const Function& function) {
+  for (size_t first = 0; first < count; first += kRaysPerJob) {
+    thread_pool.ParallelFor(std::min(kRaysPerJob, count - first),
+                            kRaysPerChunk, [&](size_t begin, size_t end) {
+                              function(first + begin, first + end);
+                            });
+  }
+}
+}  // namespace
+
+ray_tracer::RayQueryService::RayQueryService(
+    utils::numa::ThreadPool& thread_pool)
+    : thread_pool_(thread_pool),
+      dispatch_thread_([this](std::stop_token stop_token) {
+        RunDispatchThread(stop_token);
+      }) {}
+
+void ray_tracer::RayQueryService::FindClosestHits(
+    const scene::SceneGeometry& geometry, const RayBatch& rays,
+    std::span<Hit> out_hits) {
+  assert(out_hits.size() >= rays.size() &&
+         geometry.bounds.size() ==
+             geometry.meshes.size() + geometry.primitives.size());
+  ForEachRayChunk(thread_pool_, rays.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      DirectX::XMVECTOR origin{};
+      DirectX::XMVECTOR direction{};
+      LoadRay(origin, direction, rays, i);
+      out_hits[i] = Intersect(geometry, origin, direction,
+                              rays.min_distance[i], rays.max_distance[i],
+                              false);
+    }
+  });
+}
+
+void ray_tracer::RayQueryService::FindOcclusions(
+    const scene::SceneGeometry& geometry, const RayBatch& rays,
+    std::span<uint64_t> out_occluded) {
+  assert(out_occluded.size() >= (rays.size() + 63) / 64 &&
+         geometry.bounds.size() ==
+             geometry.meshes.size() + geometry.primitives.size());
+  ForEachRayChunk(thread_pool_, rays.size(), [&](size_t begin, size_t end) {
+    for (size_t word_begin = begin; word_begin < end; word_begin += 64) {
+      uint64_t word = 0;
+      for (size_t i = word_begin; i < std::min(word_begin + 64, end); ++i) {
+        DirectX::XMVECTOR origin{};
+        DirectX::XMVECTOR direction{};
+        LoadRay(origin, direction, rays, i);
+        if (Intersect(geometry, origin, direction, rays.min_distance[i],
+                      rays.max_distance[i], true)
+                .mesh_index != kNoHit) {
+          word |= uint64_t{1} << (i - word_begin);
+        }
+      }
+      out_occluded[word_begin / 64] = word;
+    }
+  });
+}
+
+void ray_tracer::RayQueryService::SubmitClosestHits(
+    std::shared_ptr<const scene::SceneGeometry> geometry,
+    const RayBatch& rays, std::span<Hit> out_hits,
+    std::function<void()> on_complete) {
+  Submit({.geometry = std::move(geometry),
+          .rays = rays,
+          .hits = out_hits,
+          .occluded = {},
+          .occlusion = false,
+          .on_complete = std::move(on_complete)});
+}
+
+void ray_tracer::RayQueryService::SubmitOcclusions(
+    std::shared_ptr<const scene::SceneGeometry> geometry,
+    const RayBatch& rays, std::span<uint64_t> out_occluded,
+    std::function<void()> on_complete) {
+  Submit({.geometry = std::move(geometry),
+          .rays = rays,
+          .hits = {},
+          .occluded = out_occluded,
+          .occlusion = true,
+          .on_complete = std::move(on_complete)});
+}
+
+void ray_tracer::RayQueryService::Wait() {
+  std::unique_lock lock(mutex_);
+  jobs_done_.wait(lock, [this] { return jobs_.empty() && !running_job_; });
+}
+
+void ray_tracer::RayQueryService::Submit(Job job) {
+  std::scoped_lock lock(mutex_);
+  jobs_.push_back(std::move(job));
+  jobs_available_.notify_one();
+}
+
+void ray_tracer::RayQueryService::RunDispatchThread(
+    std::stop_token stop_token) {
+  utils::trace::SetThreadName("ray queries");
+  while (true) {
+    Job job{};
+    {
+      std::unique_lock lock(mutex_);
+      // Returns false only once stopped and out of jobs.
+      if (!jobs_available_.wait(lock, stop_token,
+                                [this] { return !jobs_.empty(); })) {
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+      running_job_ = true;
+    }
+
+    auto scope = utils::trace::Scope("ray query batch");
+    if (job.occlusion) {
+      FindOcclusions(*job.geometry, job.rays, job.occluded);
+    } else {
+      FindClosestHits(*job.geometry, job.rays, job.hits);
+    }
+    if (job.on_complete) {
+      job.on_complete();
+    }
+
+    std::scoped_lock lock(mutex_);
+    running_job_ = false;
+    if (jobs_.empty()) {
+      jobs_done_.notify_all();
+    }
+  }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+
+#include "../scene/scene_geometry.h"
+#include "../utils/numa.h"
+#include "ray_tracer.h"
+
+namespace ray_tracer {
+// Rays as one array per component, all of the same size. Directions need not
+// be unit length; hits are only reported at world space distances in
+// `[min_distance, max_distance]`.
+struct RayBatch {
+  std::span<const float> origin_x;
+  std::span<const float> origin_y;
+  std::span<const float> origin_z;
+  std::span<const float> direction_x;
+  std::span<const float> direction_y;
+  std::span<const float> direction_z;
+  std::span<const float> min_distance;
+  std::span<const float> max_distance;
+
+  inline size_t size() const { return origin_x.size(); }
+};
+
+// `Hit::mesh_index` of rays that hit nothing.
+constexpr uint32_t kNoHit = UINT32_MAX;
+
+// Closest hit and line of sight queries for large batches of rays, run on a
+// thread pool shared with the renderer. Batches are split into pool jobs of
+// limited size, so frames are not held up for long. Submitted batches run one
+// after another on a dispatch thread. None of the functions may be called from
+// a job of the same pool.
+class RayQueryService {
+ public:
+  explicit RayQueryService(utils::numa::ThreadPool& thread_pool);
+
+  RayQueryService(const RayQueryService&) = delete;
+  RayQueryService& operator=(const RayQueryService&) = delete;
+
+  // Write the closest hit of every ray to `out_hits`.
+  void FindClosestHits(const scene::SceneGeometry& geometry,
+                       const RayBatch& rays, std::span<Hit> out_hits);
+
+  // Set bit `i % 64` of `out_occluded[i / 64]` if ray `i` hits anything.
+  void FindOcclusions(const scene::SceneGeometry& geometry,
+                      const RayBatch& rays, std::span<uint64_t> out_occluded);
+
+  // Asynchronous versions of the above. The arrays of `rays` and the output
+  // must stay valid until `on_complete` was called on the dispatch thread.
+  void SubmitClosestHits(std::shared_ptr<const scene::SceneGeometry> geometry,
+                         const RayBatch& rays, std::span<Hit> out_hits,
+                         std::function<void()> on_complete);
+
+  void SubmitOcclusions(std::shared_ptr<const scene::SceneGeometry> geometry,
+                        const RayBatch& rays,
+                        std::span<uint64_t> out_occluded,
+                        std::function<void()> on_complete);
+
+  // Wait until all submitted batches completed.
+  void Wait();
+
+ private:
+  struct Job {
+    std::shared_ptr<const scene::SceneGeometry> geometry;
+    RayBatch rays;
+    std::span<Hit> hits;
+    std::span<uint64_t> occluded;
+    bool occlusion;
+    std::function<void()> on_complete;
+  };
+
+  void RunDispatchThread(std::stop_token stop_token);
+
+  void Submit(Job job);
+
+  utils::numa::ThreadPool& thread_pool_;
+  std::mutex mutex_;
+  std::condition_variable_any jobs_available_;
+  std::condition_variable jobs_done_;
+  std::deque<Job> jobs_;
+  bool running_job_ = false;
+  // Declared last, so the thread stops before the state it uses goes away.
+  // Jobs still queued at destruction are completed first.
+  std::jthread dispatch_thread_;
+};
+}  // namespace ray_tracer
@@ -0,0 +1,152 @@
+#include "ray_query_c.h"
+
+#include <memory>
+#include <span>
+#include <utility>
+
+#include "ray_query.h"
+
+struct RtRayQueryService {
+  RtRayQueryService()
+      : thread_pool(utils::numa::GetNodes()), service(thread_pool) {}
+
+  utils::numa::ThreadPool thread_pool;
+  ray_tracer::RayQueryService service;
+};
+
+struct RtScene {
+  std::shared_ptr<const scene::SceneGeometry> geometry;
+};
+
+static_assert(sizeof(RtHit) == sizeof(ray_tracer::Hit));
+
+namespace {
+inline ray_tracer::RayBatch ToRayBatch(const RtRayBatch& rays) {
+  return {.origin_x = {rays.origin_x, rays.count},
+          .origin_y = {rays.origin_y, rays.count},
+          .origin_z = {rays.origin_z, rays.count},
+          .direction_x = {rays.direction_x, rays.count},
+          .direction_y = {rays.direction_y, rays.count},
+          .direction_z = {rays.direction_z, rays.count},
+          .min_distance = {rays.min_distance, rays.count},
+          .max_distance = {rays.max_distance, rays.count}};
+}
+
+inline std::span<ray_tracer::Hit> ToHits(RtHit* hits, size_t count) {
+  return {reinterpret_cast<ray_tracer::Hit*>(hits), count};
+}
+
+inline std::span<uint64_t> ToOcclusionWords(uint64_t* words, size_t count) {
+  return {words, (count + 63) / 64};
+}
+
+inline std::function<void()> ToCallback(RtCompletionCallback on_complete,
+                                        void* user_data) {
+  if (on_complete == nullptr) {
+    return {};
+  }
+  return [on_complete, user_data] { on_complete(user_data); };
+}
+
+// Exceptions must not cross the C boundary.
+template <typename Function>
+RtResult Guard(Function&& function) {
+  try {
+    function();
+    return RT_SUCCESS;
+  } catch (...) {
+    return RT_FAILURE;
+  }
+}
+}  // namespace
+
+RtRayQueryService* RtCreateRayQueryService() {
+  try {
+    return new RtRayQueryService();
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void RtDestroyRayQueryService(RtRayQueryService* service) { delete service; }
+
+RtScene* RtCreateScene(const RtMesh* meshes, size_t mesh_count) {
+  for (const auto& mesh : std::span(meshes, mesh_count)) {
+    for (const auto index : std::span(mesh.faces, 3 * mesh.face_count)) {
+      if (index < 0 || static_cast<size_t>(index) >= mesh.vertex_count) {
+        return nullptr;
+      }
+    }
+  }
+
+  try {
+    auto geometry = std::make_shared<scene::SceneGeometry>();
+    for (const auto& mesh : std::span(meshes, mesh_count)) {
+      scene::Mesh scene_mesh{};
+      auto& [vertices, faces] = scene_mesh;
+      for (size_t i = 0; i < mesh.vertex_count; ++i) {
+        vertices.emplace_back(mesh.vertices[3 * i], mesh.vertices[3 * i + 1],
+                              mesh.vertices[3 * i + 2]);
+      }
+      for (size_t i = 0; i < mesh.face_count; ++i) {
+        faces.emplace_back(mesh.faces[3 * i], mesh.faces[3 * i + 1],
+                           mesh.faces[3 * i + 2]);
+      }
+      DirectX::BoundingBox bounds{};
+      DirectX::BoundingBox::CreateFromPoints(
+          bounds, vertices.size(), vertices.data(), sizeof(vertices[0]));
+      geometry->bounds.push_back(bounds);
+      geometry->meshes.push_back(
+          std::make_shared<const scene::Mesh>(std::move(scene_mesh)));
+    }
+    return new RtScene{.geometry = std::move(geometry)};
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void RtReleaseScene(RtScene* scene) { delete scene; }
+
+RtResult RtFindClosestHits(RtRayQueryService* service, const RtScene* scene,
+                           const RtRayBatch* rays, RtHit* out_hits) {
+  return Guard([&] {
+    service->service.FindClosestHits(*scene->geometry, ToRayBatch(*rays),
+                                     ToHits(out_hits, rays->count));
+  });
+}
+
+RtResult RtFindOcclusions(RtRayQueryService* service, const RtScene* scene,
+                          const RtRayBatch* rays, uint64_t* out_occluded) {
+  return Guard([&] {
+    service->service.FindOcclusions(
+        *scene->geometry, ToRayBatch(*rays),
+        ToOcclusionWords(out_occluded, rays->count));
+  });
+}
+
+RtResult RtSubmitClosestHits(RtRayQueryService* service, const RtScene* scene,
+                             const RtRayBatch* rays, RtHit* out_hits,
+                             RtCompletionCallback on_complete,
+                             void* user_data) {
+  return Guard([&] {
+    service->service.SubmitClosestHits(scene->geometry, ToRayBatch(*rays),
+                                       ToHits(out_hits, rays->count),
+                                       ToCallback(on_complete, user_data));
+  });
+}
+
+RtResult RtSubmitOcclusions(RtRayQueryService* service, const RtScene* scene,
+                            const RtRayBatch* rays, uint64_t* out_occluded,
+                            RtCompletionCallback on_complete,
+                            void* user_data) {
+  return Guard([&] {
+    service->service.SubmitOcclusions(
+        scene->geometry, ToRayBatch(*rays),
+        ToOcclusionWords(out_occluded, rays->count),
+        ToCallback(on_complete, user_data));
+  });
+}
+
+RtResult RtWait(RtRayQueryService* service) {
+  return Guard([&] { service->service.Wait(); });
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+// C interface of the ray query service, for callers outside of C++.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct RtRayQueryService RtRayQueryService;
+typedef struct RtScene RtScene;
+
+// Triangles as `x, y, z` vertex positions and three vertex indices per face.
+typedef struct RtMesh {
+  const float* vertices;
+  size_t vertex_count;
+  const int32_t* faces;
+  size_t face_count;
+} RtMesh;
+
+// Rays as one array per component, see `ray_tracer::RayBatch`.
+typedef struct RtRayBatch {
+  const float* origin_x;
+  const float* origin_y;
+  const float* origin_z;
+  const float* direction_x;
+  const float* direction_y;
+  const float* direction_z;
+  const float* min_distance;
+  const float* max_distance;
+  size_t count;
+} RtRayBatch;
+
+// `mesh_index` is `UINT32_MAX` for rays that hit nothing.
+typedef struct RtHit {
+  float distance;
+  float beta;
+  float gamma;
+  uint32_t mesh_index;
+  uint32_t face_index;
+} RtHit;
+
+typedef void (*RtCompletionCallback)(void* user_data);
+
+// No C++ exception leaves these functions. Ones that create something return
+// null on failure; the others return whether they succeeded, and on failure
+// no result is written and no callback is called.
+typedef enum RtResult { RT_SUCCESS = 0, RT_FAILURE = 1 } RtResult;
+
+// Service with its own worker threads on every NUMA node.
+RtRayQueryService* RtCreateRayQueryService(void);
+
+// Completes submitted batches first.
+void RtDestroyRayQueryService(RtRayQueryService* service);
+
+// Copies the meshes. Scenes are reference counted; batches in flight keep
+// theirs alive. Null if a face index is out of range.
+RtScene* RtCreateScene(const RtMesh* meshes, size_t mesh_count);
+
+void RtReleaseScene(RtScene* scene);
+
+RtResult RtFindClosestHits(RtRayQueryService* service, const RtScene* scene,
+                           const RtRayBatch* rays, RtHit* out_hits);
+
+// Bit `i % 64` of `out_occluded[i / 64]` is set if ray `i` hits anything.
+RtResult RtFindOcclusions(RtRayQueryService* service, const RtScene* scene,
+                          const RtRayBatch* rays, uint64_t* out_occluded);
+
+// Asynchronous versions; the arrays must stay valid until `on_complete` is
+// called with `user_data` on the dispatch thread.
+RtResult RtSubmitClosestHits(RtRayQueryService* service, const RtScene* scene,
+                             const RtRayBatch* rays, RtHit* out_hits,
+                             RtCompletionCallback on_complete,
+                             void* user_data);
+
+RtResult RtSubmitOcclusions(RtRayQueryService* service, const RtScene* scene,
+                            const RtRayBatch* rays, uint64_t* out_occluded,
+                            RtCompletionCallback on_complete,
+                            void* user_data);
+
+// Wait until all submitted batches completed.
+RtResult RtWait(RtRayQueryService* service);
+
+#ifdef __cplusplus
+}
+#endif
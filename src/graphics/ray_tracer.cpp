@@ -1,9 +1,16 @@
 #include "ray_tracer.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <ranges>
 
 namespace {
+// Camera rays only hit surfaces beyond this distance.
+constexpr auto kNearDistance = 1.0f;
+// Gray of untextured primitives.
+constexpr auto kPrimitiveAlbedo = 0.8f;
+
 // Calculate distance between two vectors.
 inline float CalculateDistance(DirectX::FXMVECTOR a, DirectX::FXMVECTOR b) {
   return DirectX::XMVectorGetX(
@@ -11,16 +18,16 @@ inline float CalculateDistance(DirectX::FXMVECTOR a, DirectX::FXMVECTOR b) {
 }
 
 // Check if the ray from intersection point to light intersects with any mesh.
-inline bool IntersectsWithShadow(const std::span<scene::Mesh>& meshes,
-                                 size_t mesh_index, size_t face_index,
-                                 DirectX::FXMVECTOR intersection_point,
-                                 const DirectX::XMFLOAT3A& light_position) {
-  const auto& face = meshes[mesh_index].second[face_index];
+inline bool IntersectsWithShadow(
+    const std::span<const scene::SharedMesh>& meshes, size_t mesh_index,
+    size_t face_index, DirectX::FXMVECTOR intersection_point,
+    const DirectX::XMFLOAT3A& light_position) {
+  const auto& face = meshes[mesh_index]->second[face_index];
   DirectX::XMVECTOR vertex_a{};
   DirectX::XMVECTOR vertex_b{};
   DirectX::XMVECTOR vertex_c{};
   utils::xm::triangle::Load(vertex_a, vertex_b, vertex_c,
-                            meshes[mesh_index].first, face);
+                            meshes[mesh_index]->first, face);
   auto offset_intersection_point =
       DirectX::XMVectorAdd(intersection_point, DirectX::g_XMEpsilon);
   auto shadow_direction = utils::xm::ray::CalculateDirection(
@@ -37,7 +44,8 @@ inline bool IntersectsWithShadow(const std::span<scene::Mesh>& meshes,
 
 // Check if a point is shadowed by geometry in the scene.
 inline bool IsShadowed(DirectX::XMVECTOR& final_color,
-                       const std::span<scene::Mesh>& meshes,
+                       const std::span<const scene::SharedMesh>& meshes,
+                       std::span<const scene::Primitive> primitives,
                        size_t outer_mesh_index, size_t outer_face_index,
                        DirectX::FXMVECTOR intersection_point,
                        const DirectX::XMFLOAT3A& light_position) {
@@ -50,7 +58,7 @@ inline bool IsShadowed(DirectX::XMVECTOR& final_color,
   for (size_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index) {
     if (mesh_index == outer_mesh_index) continue;
 
-    const auto& mesh = meshes[mesh_index];
+    const auto& mesh = *meshes[mesh_index];
     for (size_t face_index = 0; face_index < mesh.second.size(); ++face_index) {
       if (mesh_index == outer_mesh_index && face_index == outer_face_index)
         continue;
@@ -74,6 +82,22 @@ inline bool IsShadowed(DirectX::XMVECTOR& final_color,
     }
   }
 
+  // Primitives are convex, so they do not shadow themselves.
+  const float light_distance = CalculateDistance(
+      DirectX::XMLoadFloat3A(&light_position), intersection_point);
+  for (size_t primitive_index = 0; primitive_index < primitives.size();
+       ++primitive_index) {
+    if (meshes.size() + primitive_index == outer_mesh_index) continue;
+
+    const auto distance = scene::IntersectPrimitive(
+        primitives[primitive_index],
+        DirectX::XMVectorAdd(intersection_point, DirectX::g_XMEpsilon),
+        shadow_direction, 0.0f);
+    if (distance.has_value() && *distance < light_distance) {
+      total_intensity += 1.0f / (light_distance * light_distance);
+    }
+  }
+
   // Update the color based on the total intensity.
   final_color = DirectX::XMVectorReplicate(total_intensity);
 
@@ -82,19 +106,18 @@ inline bool IsShadowed(DirectX::XMVECTOR& final_color,
 
 // Check if the ray from intersection point to reflection intersects with any
 // mesh.
-inline bool IntersectsWithReflection(DirectX::XMVECTOR& final_color,
-                                     const std::span<scene::Mesh>& meshes,
-                                     size_t mesh_index, size_t face_index,
-                                     DirectX::FXMVECTOR intersection_point,
-                                     DirectX::FXMVECTOR incident_direction,
-                                     DirectX::FXMVECTOR surface_normal,
-                                     float reflectivity) {
+inline bool IntersectsWithReflection(
+    DirectX::XMVECTOR& final_color,
+    const std::span<const scene::SharedMesh>& meshes, size_t mesh_index,
+    size_t face_index, DirectX::FXMVECTOR intersection_point,
+    DirectX::FXMVECTOR incident_direction, DirectX::FXMVECTOR surface_normal,
+    float reflectivity) {
   DirectX::XMVECTOR vertex_a{};
   DirectX::XMVECTOR vertex_b{};
   DirectX::XMVECTOR vertex_c{};
   utils::xm::triangle::Load(vertex_a, vertex_b, vertex_c,
-                            meshes[mesh_index].first,
-                            meshes[mesh_index].second[face_index]);
+                            meshes[mesh_index]->first,
+                            meshes[mesh_index]->second[face_index]);
 
   // Calculate reflection direction
   const auto reflection_direction = DirectX::XMVector3NormalizeEst(
@@ -126,7 +149,8 @@ inline bool IntersectsWithReflection(DirectX::XMVECTOR& final_color,
 
 // Trace the reflection ray and calculate reflection color.
 inline void TraceReflectionRay(DirectX::XMVECTOR& final_color,
-                               const std::span<scene::Mesh>& meshes,
+                               const std::span<const scene::SharedMesh>& meshes,
+                               std::span<const scene::Primitive> primitives,
                                size_t outer_mesh_index, size_t outer_face_index,
                                DirectX::FXMVECTOR intersection_point,
                                DirectX::FXMVECTOR incident_direction,
@@ -141,7 +165,7 @@ inline void TraceReflectionRay(DirectX::XMVECTOR& final_color,
       continue;  // Skip the same mesh.
     }
 
-    for (size_t face_index = 0; face_index < meshes[mesh_index].second.size();
+    for (size_t face_index = 0; face_index < meshes[mesh_index]->second.size();
          ++face_index) {
       if (mesh_index == outer_mesh_index && face_index == outer_face_index) {
         continue;  // Skip the same face.
@@ -155,6 +179,25 @@ inline void TraceReflectionRay(DirectX::XMVECTOR& final_color,
       }
     }
   }
+
+  const auto offset_intersection_point =
+      DirectX::XMVectorAdd(intersection_point, DirectX::g_XMEpsilon);
+  for (size_t primitive_index = 0; primitive_index < primitives.size();
+       ++primitive_index) {
+    if (meshes.size() + primitive_index == outer_mesh_index) {
+      continue;  // Skip the same primitive.
+    }
+
+    if (scene::IntersectPrimitive(primitives[primitive_index],
+                                  offset_intersection_point,
+                                  reflection_direction, 0.0f)
+            .has_value()) {
+      const auto reflection_color = DirectX::XMVectorMultiply(
+          DirectX::XMVectorReplicate(kPrimitiveAlbedo), final_color);
+      final_color = DirectX::XMVectorSaturate(
+          DirectX::XMVectorLerp(final_color, reflection_color, kReflectivity));
+    }
+  }
 }
 
 inline float CalculateLambertian(DirectX::FXMVECTOR surface_normal,
@@ -164,88 +207,363 @@ inline float CalculateLambertian(DirectX::FXMVECTOR surface_normal,
 
   return intensity;
 }
+// Replace `closest_hit` by the nearest face of a mesh that is beyond
+// `min_distance` and closer than `closest_hit`.
+inline void IntersectMesh(std::optional<ray_tracer::Hit>& closest_hit,
+                          const std::span<const scene::SharedMesh>& meshes,
+                          size_t mesh_index, DirectX::FXMVECTOR world_direction,
+                          DirectX::FXMVECTOR world_origin,
+                          float min_distance) {
+  const auto& mesh = *meshes[mesh_index];
+  float closest_distance = closest_hit.has_value()
+                               ? closest_hit->distance
+                               : std::numeric_limits<float>::infinity();
+
+  for (size_t face_index = 0; face_index < mesh.second.size(); ++face_index) {
+    DirectX::XMVECTOR vertex_a{};
+    DirectX::XMVECTOR vertex_b{};
+    DirectX::XMVECTOR vertex_c{};
+    utils::xm::triangle::Load(vertex_a, vertex_b, vertex_c, mesh.first,
+                              mesh.second[face_index]);
+
+    const auto intersection_result = utils::xm::triangle::Intersect(
+        vertex_a, vertex_b, vertex_c, world_origin, world_direction);
+
+    if (intersection_result.has_value() &&
+        intersection_result->z > min_distance &&
+        intersection_result->z < closest_distance) {
+      closest_distance = intersection_result->z;
+      closest_hit = ray_tracer::Hit{
+          .distance = intersection_result->z,
+          .beta = intersection_result->x,
+          .gamma = intersection_result->y,
+          .mesh_index = static_cast<uint32_t>(mesh_index),
+          .face_index = static_cast<uint32_t>(face_index)};
+    }
+  }
+}
+
+// Distance to a primitive if it is beyond `min_distance` and closer than
+// `closest_distance`.
+inline std::optional<float> IntersectCloserPrimitive(
+    std::span<const scene::Primitive> primitives, size_t primitive_index,
+    float closest_distance, DirectX::FXMVECTOR world_direction,
+    DirectX::FXMVECTOR world_origin, float min_distance) {
+  const auto distance =
+      scene::IntersectPrimitive(primitives[primitive_index], world_origin,
+                                world_direction, min_distance);
+  if (!distance.has_value() || *distance >= closest_distance) {
+    return std::nullopt;
+  }
+  return distance;
+}
 }  // namespace
 
-DirectX::XMVECTOR ray_tracer::TraceRays(
-    ShadowVisibility shadow_visibility,
-    ReflectionVisibility reflection_visibility, std::span<scene::Mesh> meshes,
-    DirectX::FXMVECTOR world_direction, DirectX::FXMVECTOR world_origin,
-    std::span<const DirectX::XMFLOAT3A> light_positions) {
-  float closest_distance = std::numeric_limits<float>::infinity();
-  const auto ambient_color = DirectX::XMVectorReplicate(0.2f);
-  DirectX::XMVECTOR result_color = DirectX::g_XMOne;
+std::optional<ray_tracer::Hit> ray_tracer::FindClosestHit(
+    std::span<const scene::SharedMesh> meshes,
+    std::span<const scene::Primitive> primitives,
+    DirectX::FXMVECTOR world_direction, DirectX::FXMVECTOR world_origin) {
+  return FindClosestHit(meshes, primitives, world_direction, world_origin,
+                        kNearDistance);
+}
 
+std::optional<ray_tracer::Hit> ray_tracer::FindClosestHit(
+    std::span<const scene::SharedMesh> meshes,
+    std::span<const scene::Primitive> primitives,
+    DirectX::FXMVECTOR world_direction, DirectX::FXMVECTOR world_origin,
+    float min_distance) {
+  std::optional<Hit> closest_hit{};
   for (size_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index) {
-    for (size_t face_index = 0; face_index < meshes[mesh_index].second.size();
-         ++face_index) {
+    IntersectMesh(closest_hit, meshes, mesh_index, world_direction,
+                  world_origin, min_distance);
+  }
+
+  float closest_distance = closest_hit.has_value()
+                               ? closest_hit->distance
+                               : std::numeric_limits<float>::infinity();
+  std::optional<size_t> closest_primitive{};
+  for (size_t primitive_index = 0; primitive_index < primitives.size();
+       ++primitive_index) {
+    const auto distance = IntersectCloserPrimitive(
+        primitives, primitive_index, closest_distance, world_direction,
+        world_origin, min_distance);
+    if (distance.has_value()) {
+      closest_distance = *distance;
+      closest_primitive = primitive_index;
+    }
+  }
+  if (closest_primitive.has_value()) {
+    closest_hit =
+        MakePrimitiveHit(primitives, meshes.size(), *closest_primitive,
+                         closest_distance, world_direction, world_origin);
+  }
+  return closest_hit;
+}
+
+std::optional<ray_tracer::Hit> ray_tracer::FindClosestHit(
+    std::span<const scene::SharedMesh> meshes,
+    std::span<const scene::Primitive> primitives,
+    std::span<const uint32_t> mesh_indices, DirectX::FXMVECTOR world_direction,
+    DirectX::FXMVECTOR world_origin) {
+  std::optional<Hit> closest_hit{};
+  for (const auto mesh_index : mesh_indices) {
+    if (mesh_index < meshes.size()) {
+      IntersectMesh(closest_hit, meshes, mesh_index, world_direction,
+                    world_origin, kNearDistance);
+    }
+  }
+  FindCloserPrimitiveHit(closest_hit, meshes.size(), primitives, mesh_indices,
+                         world_direction, world_origin);
+  return closest_hit;
+}
+
+void ray_tracer::FindCloserPrimitiveHit(
+    std::optional<Hit>& closest_hit, size_t mesh_count,
+    std::span<const scene::Primitive> primitives,
+    std::span<const uint32_t> mesh_indices, DirectX::FXMVECTOR world_direction,
+    DirectX::FXMVECTOR world_origin) {
+  float closest_distance = closest_hit.has_value()
+                               ? closest_hit->distance
+                               : std::numeric_limits<float>::infinity();
+  std::optional<size_t> closest_primitive{};
+  for (const auto mesh_index : mesh_indices) {
+    if (mesh_index < mesh_count) continue;
+    const auto distance = IntersectCloserPrimitive(
+        primitives, mesh_index - mesh_count, closest_distance, world_direction,
+        world_origin, kNearDistance);
+    if (distance.has_value()) {
+      closest_distance = *distance;
+      closest_primitive = mesh_index - mesh_count;
+    }
+  }
+  if (closest_primitive.has_value()) {
+    closest_hit = MakePrimitiveHit(
+        primitives, mesh_count, *closest_primitive, closest_distance,
+        world_direction, world_origin);
+  }
+}
+
+bool ray_tracer::IsOccluded(std::span<const scene::SharedMesh> meshes,
+                            std::span<const scene::Primitive> primitives,
+                            DirectX::FXMVECTOR origin,
+                            DirectX::FXMVECTOR direction, float max_distance) {
+  for (const auto& mesh : meshes) {
+    for (const auto& face : mesh->second) {
       DirectX::XMVECTOR vertex_a{};
       DirectX::XMVECTOR vertex_b{};
       DirectX::XMVECTOR vertex_c{};
-      utils::xm::triangle::Load(vertex_a, vertex_b, vertex_c,
-                                meshes[mesh_index].first,
-                                meshes[mesh_index].second[face_index]);
-
-      const auto intersection_result = utils::xm::triangle::Intersect(
-          vertex_a, vertex_b, vertex_c, world_origin, world_direction);
-
-      if (intersection_result.has_value() && intersection_result->z > 1.0f &&
-          intersection_result->z < closest_distance) {
-        const auto intersection_point = utils::xm::ray::At(
-            world_origin, world_direction, intersection_result->z);
-
-        DirectX::XMVECTOR barycentric_coords = DirectX::XMVectorSet(
-            1.0f - intersection_result->x - intersection_result->y,
-            intersection_result->x, intersection_result->y, 1.0f);
-
-        DirectX::XMVECTOR surface_normal =
-            DirectX::XMVector3Normalize(utils::xm::triangle::GetSurfaceNormal(
-                vertex_a, vertex_b, vertex_c));
-
-        DirectX::XMVECTOR accumulated_color = DirectX::g_XMZero;
-
-        for (const auto& light_position : light_positions) {
-          bool in_shadow = false;
-          if (shadow_visibility == ShadowVisibility::Visible) {
-            DirectX::XMVECTOR shadow_color = result_color;
-            in_shadow |=
-                IsShadowed(shadow_color, meshes, mesh_index, face_index,
-                           intersection_point, light_position);
-            result_color = shadow_color;
-          }
-
-          if (!in_shadow) {
-            DirectX::XMVECTOR light_direction =
-                utils::xm::ray::CalculateDirection(
-                    intersection_point,
-                    utils::xm::float3a::Load(light_position));
-
-            constexpr auto ambient_intensity = 0.25f;
-            float light_intensity =
-                CalculateLambertian(surface_normal, light_direction) +
-                ambient_intensity;
-
-            DirectX::XMVECTOR lambertian_color =
-                DirectX::XMVectorReplicate(light_intensity * 0.8f);
-
-            accumulated_color = DirectX::XMVectorMultiplyAdd(
-                barycentric_coords, lambertian_color, accumulated_color);
-          }
-        }
-
-        accumulated_color = DirectX::XMVectorMultiplyAdd(
-            ambient_color, DirectX::g_XMOne, accumulated_color);
-        result_color = DirectX::XMVectorSaturate(accumulated_color);
-
-        if (reflection_visibility == ReflectionVisibility::Visible) {
-          TraceReflectionRay(result_color, meshes, mesh_index, face_index,
-                             intersection_point, world_direction,
-                             surface_normal);
-        }
-
-        closest_distance = intersection_result->z;
+      utils::xm::triangle::Load(vertex_a, vertex_b, vertex_c, mesh->first,
+                                face);
+      const auto intersection = utils::xm::triangle::Intersect(
+          vertex_a, vertex_b, vertex_c, origin, direction);
+      if (intersection.has_value() && intersection->z > 0.0f &&
+          intersection->z < max_distance) {
+        return true;
       }
     }
   }
+  for (const auto& primitive : primitives) {
+    const auto distance =
+        scene::IntersectPrimitive(primitive, origin, direction, 0.0f);
+    if (distance.has_value() && *distance < max_distance) {
+      return true;
+    }
+  }
+  return false;
+}
+
+ray_tracer::Hit ray_tracer::MakePrimitiveHit(
+    std::span<const scene::Primitive> primitives, size_t mesh_count,
+    size_t primitive_index, float distance, DirectX::FXMVECTOR world_direction,
+    DirectX::FXMVECTOR world_origin) {
+  uint32_t face = 0;
+  const auto uv = scene::GetPrimitiveUv(
+      primitives[primitive_index],
+      utils::xm::ray::At(world_origin, world_direction, distance), face);
+  return {.distance = distance,
+          .beta = uv.x,
+          .gamma = uv.y,
+          .mesh_index = static_cast<uint32_t>(mesh_count + primitive_index),
+          .face_index = face};
+}
+
+DirectX::XMVECTOR ray_tracer::GetHitNormal(
+    std::span<const scene::SharedMesh> meshes,
+    std::span<const scene::Primitive> primitives, const Hit& hit,
+    DirectX::FXMVECTOR world_direction, DirectX::FXMVECTOR world_origin) {
+  if (hit.mesh_index >= meshes.size()) {
+    return scene::GetPrimitiveNormal(
+        primitives[hit.mesh_index - meshes.size()],
+        utils::xm::ray::At(world_origin, world_direction, hit.distance),
+        hit.face_index);
+  }
+  DirectX::XMVECTOR vertex_a{};
+  DirectX::XMVECTOR vertex_b{};
+  DirectX::XMVECTOR vertex_c{};
+  utils::xm::triangle::Load(vertex_a, vertex_b, vertex_c,
+                            meshes[hit.mesh_index]->first,
+                            meshes[hit.mesh_index]->second[hit.face_index]);
+  return DirectX::XMVector3Normalize(
+      utils::xm::triangle::GetSurfaceNormal(vertex_a, vertex_b, vertex_c));
+}
+
+DirectX::XMVECTOR ray_tracer::GetHitAlbedo(
+    std::span<const scene::SharedMesh> meshes, const Hit& hit) {
+  if (hit.mesh_index >= meshes.size()) {
+    return DirectX::XMVectorSet(kPrimitiveAlbedo, kPrimitiveAlbedo,
+                                kPrimitiveAlbedo, 1.0f);
+  }
+  return DirectX::XMVectorSet(1.0f - hit.beta - hit.gamma, hit.beta, hit.gamma,
+                              1.0f);
+}
+
+DirectX::XMFLOAT2 ray_tracer::GetHitUv(
+    std::span<const scene::SharedMesh> meshes,
+    std::span<const scene::SharedMeshUvs> mesh_uvs, const Hit& hit) {
+  if (hit.mesh_index >= meshes.size()) {
+    return {hit.beta, hit.gamma};
+  }
+  const auto& uvs = *mesh_uvs[hit.mesh_index];
+  const auto& face = meshes[hit.mesh_index]->second[hit.face_index];
+  const auto uv = utils::xm::triangle::Interpolate(
+      DirectX::XMLoadFloat2(&uvs[static_cast<size_t>(face.x)]),
+      DirectX::XMLoadFloat2(&uvs[static_cast<size_t>(face.y)]),
+      DirectX::XMLoadFloat2(&uvs[static_cast<size_t>(face.z)]),
+      DirectX::XMVectorSet(1.0f - hit.beta - hit.gamma, hit.beta, hit.gamma,
+                           0.0f));
+  return {DirectX::XMVectorGetX(uv), DirectX::XMVectorGetY(uv)};
+}
+
+float ray_tracer::GetHitTextureLod(
+    std::span<const scene::SharedMesh> meshes,
+    std::span<const scene::Primitive> primitives,
+    std::span<const scene::SharedMeshUvs> mesh_uvs, const Hit& hit,
+    DirectX::FXMVECTOR world_direction, DirectX::FXMVECTOR world_origin,
+    float spread_angle, DirectX::XMUINT2 texture_size) {
+  const float texture_area =
+      static_cast<float>(texture_size.x) * static_cast<float>(texture_size.y);
+  // Texels per unit of world area.
+  float texel_density = 0.0f;
+  DirectX::XMVECTOR normal{};
+  if (hit.mesh_index >= meshes.size()) {
+    texel_density =
+        scene::GetPrimitiveUvDensity(
+            primitives[hit.mesh_index - meshes.size()]) *
+        texture_area;
+    normal = GetHitNormal(meshes, primitives, hit, world_direction,
+                          world_origin);
+  } else {
+    const auto& face = meshes[hit.mesh_index]->second[hit.face_index];
+    DirectX::XMVECTOR vertex_a{};
+    DirectX::XMVECTOR vertex_b{};
+    DirectX::XMVECTOR vertex_c{};
+    utils::xm::triangle::Load(vertex_a, vertex_b, vertex_c,
+                              meshes[hit.mesh_index]->first, face);
+    normal =
+        utils::xm::triangle::GetSurfaceNormal(vertex_a, vertex_b, vertex_c);
+    // Twice the areas; the factors cancel out.
+    const float world_area =
+        DirectX::XMVectorGetX(DirectX::XMVector3Length(normal));
+
+    const auto& uvs = *mesh_uvs[hit.mesh_index];
+    const auto& uv_a = uvs[static_cast<size_t>(face.x)];
+    const auto& uv_b = uvs[static_cast<size_t>(face.y)];
+    const auto& uv_c = uvs[static_cast<size_t>(face.z)];
+    const float texel_area = std::fabs((uv_b.x - uv_a.x) * (uv_c.y - uv_a.y) -
+                                       (uv_c.x - uv_a.x) * (uv_b.y - uv_a.y)) *
+                             texture_area;
+    if (world_area <= 0.0f) {
+      return 0.0f;
+    }
+    texel_density = texel_area / world_area;
+    normal = DirectX::XMVectorDivide(normal,
+                                     DirectX::XMVectorReplicate(world_area));
+  }
+  if (texel_density <= 0.0f) {
+    return 0.0f;
+  }
+
+  const float cone_width = spread_angle * hit.distance;
+  const float cosine = std::fabs(DirectX::XMVectorGetX(
+      DirectX::XMVector3Dot(normal, world_direction)));
+  return 0.5f * std::log2(texel_density) +
+         std::log2(cone_width / std::fmaxf(cosine, 1.0e-3f));
+}
+
+DirectX::XMVECTOR ray_tracer::ShadeHit(
+    ShadowVisibility shadow_visibility,
+    ReflectionVisibility reflection_visibility,
+    std::span<const scene::SharedMesh> meshes,
+    std::span<const scene::Primitive> primitives, const Hit& hit,
+    DirectX::FXMVECTOR world_direction, DirectX::FXMVECTOR world_origin,
+    DirectX::FXMVECTOR albedo, float ambient_visibility,
+    std::span<const DirectX::XMFLOAT3A> light_positions) {
+  const auto ambient_color =
+      DirectX::XMVectorReplicate(0.2f * ambient_visibility);
+  const size_t mesh_index = hit.mesh_index;
+  const size_t face_index = hit.face_index;
+
+  const auto intersection_point =
+      utils::xm::ray::At(world_origin, world_direction, hit.distance);
+
+  DirectX::XMVECTOR surface_normal =
+      GetHitNormal(meshes, primitives, hit, world_direction, world_origin);
+
+  DirectX::XMVECTOR accumulated_color = DirectX::g_XMZero;
+
+  for (const auto& light_position : light_positions) {
+    bool in_shadow = false;
+    if (shadow_visibility == ShadowVisibility::Visible) {
+      DirectX::XMVECTOR shadow_color{};
+      in_shadow |=
+          IsShadowed(shadow_color, meshes, primitives, mesh_index, face_index,
+                     intersection_point, light_position);
+    }
+
+    if (!in_shadow) {
+      DirectX::XMVECTOR light_direction = utils::xm::ray::CalculateDirection(
+          intersection_point, utils::xm::float3a::Load(light_position));
+
+      constexpr auto ambient_intensity = 0.25f;
+      float light_intensity =
+          CalculateLambertian(surface_normal, light_direction) +
+          ambient_intensity * ambient_visibility;
+
+      DirectX::XMVECTOR lambertian_color =
+          DirectX::XMVectorReplicate(light_intensity * 0.8f);
+
+      accumulated_color = DirectX::XMVectorMultiplyAdd(
+          albedo, lambertian_color, accumulated_color);
+    }
+  }
+
+  accumulated_color = DirectX::XMVectorMultiplyAdd(
+      ambient_color, DirectX::g_XMOne, accumulated_color);
+  DirectX::XMVECTOR result_color = DirectX::XMVectorSaturate(accumulated_color);
+
+  if (reflection_visibility == ReflectionVisibility::Visible) {
+    TraceReflectionRay(result_color, meshes, primitives, mesh_index,
+                       face_index, intersection_point, world_direction,
+                       surface_normal);
+  }
 
   return result_color;
 }
+
+DirectX::XMVECTOR ray_tracer::TraceRays(
+    ShadowVisibility shadow_visibility,
+    ReflectionVisibility reflection_visibility,
+    std::span<const scene::SharedMesh> meshes,
+    std::span<const scene::Primitive> primitives,
+    DirectX::FXMVECTOR world_direction, DirectX::FXMVECTOR world_origin,
+    std::span<const DirectX::XMFLOAT3A> light_positions) {
+  const auto hit =
+      FindClosestHit(meshes, primitives, world_direction, world_origin);
+  if (!hit.has_value()) {
+    return DirectX::g_XMOne;
+  }
+
+  return ShadeHit(shadow_visibility, reflection_visibility, meshes, primitives,
+                  *hit, world_direction, world_origin,
+                  GetHitAlbedo(meshes, *hit), 1.0f, light_positions);
+}
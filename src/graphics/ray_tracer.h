@@ -1,17 +1,115 @@
 #pragma once
 
+#include <cstdint>
+#include <optional>
 #include <span>
 
 #include "../scene/mesh.h"
+#include "../scene/primitive.h"
 #include "../utils/xm.h"
 
 namespace ray_tracer {
 enum class ShadowVisibility { Visible, Hidden };
 enum class ReflectionVisibility { Visible, Hidden };
 
+// Closest intersection of a camera ray with the scene. `mesh_index` counts the
+// meshes first and the primitives after them. For primitives, `beta` and
+// `gamma` are the texture coordinates and `face_index` the face of a box.
+struct Hit {
+  float distance;
+  float beta;
+  float gamma;
+  uint32_t mesh_index;
+  uint32_t face_index;
+};
+
+std::optional<Hit> FindClosestHit(std::span<const scene::SharedMesh> meshes,
+                                  std::span<const scene::Primitive> primitives,
+                                  DirectX::FXMVECTOR world_direction,
+                                  DirectX::FXMVECTOR world_origin);
+
+// Closest hit beyond `min_distance` instead of the near distance of camera
+// rays, e.g. of a ray that leaves a surface.
+std::optional<Hit> FindClosestHit(std::span<const scene::SharedMesh> meshes,
+                                  std::span<const scene::Primitive> primitives,
+                                  DirectX::FXMVECTOR world_direction,
+                                  DirectX::FXMVECTOR world_origin,
+                                  float min_distance);
+
+// Only test the meshes and primitives listed in `mesh_indices`, e.g. the ones
+// that survived culling.
+std::optional<Hit> FindClosestHit(std::span<const scene::SharedMesh> meshes,
+                                  std::span<const scene::Primitive> primitives,
+                                  std::span<const uint32_t> mesh_indices,
+                                  DirectX::FXMVECTOR world_direction,
+                                  DirectX::FXMVECTOR world_origin);
+
+// Replace `closest_hit` by a closer hit of the primitives listed in
+// `mesh_indices`, e.g. to complete a rasterized hit of the meshes.
+void FindCloserPrimitiveHit(std::optional<Hit>& closest_hit,
+                            size_t mesh_count,
+                            std::span<const scene::Primitive> primitives,
+                            std::span<const uint32_t> mesh_indices,
+                            DirectX::FXMVECTOR world_direction,
+                            DirectX::FXMVECTOR world_origin);
+
+// Whether anything is hit along the unit `direction` closer than
+// `max_distance`. The origin is expected to be offset from the surface it
+// leaves.
+bool IsOccluded(std::span<const scene::SharedMesh> meshes,
+                std::span<const scene::Primitive> primitives,
+                DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction,
+                float max_distance);
+
+// Hit of primitive `primitive_index` at `distance` along the ray.
+Hit MakePrimitiveHit(std::span<const scene::Primitive> primitives,
+                     size_t mesh_count, size_t primitive_index, float distance,
+                     DirectX::FXMVECTOR world_direction,
+                     DirectX::FXMVECTOR world_origin);
+
+// Unit normal of the surface that was hit by the ray.
+DirectX::XMVECTOR GetHitNormal(std::span<const scene::SharedMesh> meshes,
+                               std::span<const scene::Primitive> primitives,
+                               const Hit& hit,
+                               DirectX::FXMVECTOR world_direction,
+                               DirectX::FXMVECTOR world_origin);
+
+// Surface color before lighting of untextured surfaces. Faces of meshes are
+// colored by the barycentric coordinates of the hit, primitives are gray.
+DirectX::XMVECTOR GetHitAlbedo(std::span<const scene::SharedMesh> meshes,
+                               const Hit& hit);
+
+// Texture coordinates at the hit. On meshes they are interpolated from
+// `mesh_uvs`, the texture coordinates of the vertices of each mesh.
+DirectX::XMFLOAT2 GetHitUv(std::span<const scene::SharedMesh> meshes,
+                           std::span<const scene::SharedMeshUvs> mesh_uvs,
+                           const Hit& hit);
+
+// Mip level of a texture of `texture_size` texels for a ray cone that widens
+// by `spread_angle` radians per unit of distance: the texel to world area
+// ratio of the surface plus the width of the cone on the surface at the hit.
+float GetHitTextureLod(std::span<const scene::SharedMesh> meshes,
+                       std::span<const scene::Primitive> primitives,
+                       std::span<const scene::SharedMeshUvs> mesh_uvs,
+                       const Hit& hit, DirectX::FXMVECTOR world_direction,
+                       DirectX::FXMVECTOR world_origin, float spread_angle,
+                       DirectX::XMUINT2 texture_size);
+
+// `ambient_visibility` scales the ambient light, 1 where nothing occludes it.
+DirectX::XMVECTOR ShadeHit(ShadowVisibility shadow_visibility,
+                           ReflectionVisibility reflection_visibility,
+                           std::span<const scene::SharedMesh> meshes,
+                           std::span<const scene::Primitive> primitives,
+                           const Hit& hit, DirectX::FXMVECTOR world_direction,
+                           DirectX::FXMVECTOR world_origin,
+                           DirectX::FXMVECTOR albedo, float ambient_visibility,
+                           std::span<const DirectX::XMFLOAT3A> light_positions);
+
 DirectX::XMVECTOR TraceRays(
     ShadowVisibility shadow_visibility,
-    ReflectionVisibility reflection_visibility, std::span<scene::Mesh> meshes,
+    ReflectionVisibility reflection_visibility,
+    std::span<const scene::SharedMesh> meshes,
+    std::span<const scene::Primitive> primitives,
     DirectX::FXMVECTOR world_direction, DirectX::FXMVECTOR world_origin,
     std::span<const DirectX::XMFLOAT3A> light_positions);
 }  // namespace ray_tracer
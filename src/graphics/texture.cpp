@@ -0,0 +1,199 @@
+#include "texture.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <limits>
+
+namespace {
+constexpr std::array<char, 4> kTextureFileMagic = {'R', 'T', 'T', '1'};
+// Magic, width and height.
+constexpr size_t kTextureFileHeaderBytes = 12;
+
+// Next number of a PPM header, after white space and comments.
+std::optional<unsigned int> ReadPpmNumber(std::istream& file) {
+  while (true) {
+    const int c = file.peek();
+    if (c == '#') {
+      file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    } else if (c != EOF && std::isspace(c)) {
+      file.get();
+    } else {
+      break;
+    }
+  }
+  unsigned int value = 0;
+  if (!(file >> value)) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+// Average of the 2x2 texels under each texel of the next level. Odd rows and
+// columns at the edge are averaged with themselves.
+ray_tracer::TextureImage Downsample(const ray_tracer::TextureImage& image) {
+  ray_tracer::TextureImage half{.width = std::max(image.width / 2, 1U),
+                                .height = std::max(image.height / 2, 1U),
+                                .texels = {}};
+  half.texels.resize(static_cast<size_t>(half.width) * half.height);
+  const auto at = [&](unsigned int x, unsigned int y) {
+    return image.texels[static_cast<size_t>(std::min(y, image.height - 1)) *
+                            image.width +
+                        std::min(x, image.width - 1)];
+  };
+  for (auto y = 0U; y < half.height; ++y) {
+    for (auto x = 0U; x < half.width; ++x) {
+      const std::array<uint32_t, 4> texels = {
+          at(2 * x, 2 * y), at(2 * x + 1, 2 * y), at(2 * x, 2 * y + 1),
+          at(2 * x + 1, 2 * y + 1)};
+      uint32_t average = 0;
+      for (auto shift = 0U; shift < 32; shift += 8) {
+        uint32_t sum = 2;
+        for (const auto texel : texels) {
+          sum += (texel >> shift) & 0xFFU;
+        }
+        average |= (sum / 4) << shift;
+      }
+      half.texels[static_cast<size_t>(y) * half.width + x] = average;
+    }
+  }
+  return half;
+}
+}  // namespace
+
+std::optional<ray_tracer::TextureImage> ray_tracer::LoadPpm(
+    const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  std::array<char, 2> magic{};
+  file.read(magic.data(), magic.size());
+  if (!file || magic != std::array<char, 2>{'P', '6'}) {
+    return std::nullopt;
+  }
+
+  const auto width = ReadPpmNumber(file);
+  const auto height = ReadPpmNumber(file);
+  const auto max_value = ReadPpmNumber(file);
+  if (!width || !height || !max_value || *width == 0 || *height == 0 ||
+      *max_value == 0 || *max_value > 255) {
+    return std::nullopt;
+  }
+  // A single white space character separates the header from the texels.
+  file.get();
+
+  std::vector<uint8_t> rgb(static_cast<size_t>(*width) * *height * 3);
+  file.read(reinterpret_cast<char*>(rgb.data()),
+            static_cast<std::streamsize>(rgb.size()));
+  if (!file) {
+    return std::nullopt;
+  }
+
+  TextureImage image{.width = *width, .height = *height, .texels = {}};
+  image.texels.resize(static_cast<size_t>(*width) * *height);
+  const auto scale = [&](uint8_t value) {
+    return static_cast<uint32_t>(value) * 255 / *max_value;
+  };
+  for (size_t i = 0; i < image.texels.size(); ++i) {
+    image.texels[i] = scale(rgb[3 * i]) | (scale(rgb[3 * i + 1]) << 8U) |
+                      (scale(rgb[3 * i + 2]) << 16U) | 0xFF000000U;
+  }
+  return image;
+}
+
+ray_tracer::TextureImage ray_tracer::CreateCheckerboard(unsigned int size,
+                                                        unsigned int squares,
+                                                        uint32_t color_a,
+                                                        uint32_t color_b) {
+  TextureImage image{.width = size, .height = size, .texels = {}};
+  image.texels.resize(static_cast<size_t>(size) * size);
+  const unsigned int square_size = std::max(size / std::max(squares, 1U), 1U);
+  for (auto y = 0U; y < size; ++y) {
+    for (auto x = 0U; x < size; ++x) {
+      image.texels[static_cast<size_t>(y) * size + x] =
+          ((x / square_size + y / square_size) % 2 == 0) ? color_a : color_b;
+    }
+  }
+  return image;
+}
+
+std::vector<ray_tracer::TextureLevel> ray_tracer::GetTextureLevels(
+    unsigned int width, unsigned int height) {
+  std::vector<TextureLevel> levels{};
+  if (width == 0 || height == 0) {
+    return levels;
+  }
+
+  size_t offset = kTextureFileHeaderBytes;
+  while (true) {
+    const TextureLevel level{
+        .width = width,
+        .height = height,
+        .tile_columns = (width + kTextureTileSize - 1) / kTextureTileSize,
+        .tile_rows = (height + kTextureTileSize - 1) / kTextureTileSize,
+        .offset = offset};
+    levels.push_back(level);
+    offset += static_cast<size_t>(level.tile_columns) * level.tile_rows *
+              kTextureTileBytes;
+    if (width == 1 && height == 1) {
+      return levels;
+    }
+    width = std::max(width / 2, 1U);
+    height = std::max(height / 2, 1U);
+  }
+}
+
+bool ray_tracer::WriteTiledTexture(const TextureImage& image,
+                                   const std::filesystem::path& path) {
+  if (image.width == 0 || image.height == 0 ||
+      image.texels.size() != static_cast<size_t>(image.width) * image.height) {
+    return false;
+  }
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+
+  file.write(kTextureFileMagic.data(), kTextureFileMagic.size());
+  file.write(reinterpret_cast<const char*>(&image.width),
+             sizeof(image.width));
+  file.write(reinterpret_cast<const char*>(&image.height),
+             sizeof(image.height));
+
+  std::vector<uint32_t> tile(kTextureTileTexels);
+  TextureImage level_image = image;
+  for (const auto& level : GetTextureLevels(image.width, image.height)) {
+    if (level.offset != kTextureFileHeaderBytes) {
+      level_image = Downsample(level_image);
+    }
+    for (auto tile_y = 0U; tile_y < level.tile_rows; ++tile_y) {
+      for (auto tile_x = 0U; tile_x < level.tile_columns; ++tile_x) {
+        for (auto y = 0U; y < kTextureTileStride; ++y) {
+          const auto row = (tile_y * kTextureTileSize + y) % level.height;
+          for (auto x = 0U; x < kTextureTileStride; ++x) {
+            const auto column = (tile_x * kTextureTileSize + x) % level.width;
+            tile[static_cast<size_t>(y) * kTextureTileStride + x] =
+                level_image.texels[static_cast<size_t>(row) * level.width +
+                                   column];
+          }
+        }
+        file.write(reinterpret_cast<const char*>(tile.data()),
+                   static_cast<std::streamsize>(kTextureTileBytes));
+      }
+    }
+  }
+  return static_cast<bool>(file);
+}
+
+std::optional<DirectX::XMUINT2> ray_tracer::ReadTiledTextureSize(
+    const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  std::array<char, 4> magic{};
+  DirectX::XMUINT2 size{};
+  file.read(magic.data(), magic.size());
+  file.read(reinterpret_cast<char*>(&size.x), sizeof(size.x));
+  file.read(reinterpret_cast<char*>(&size.y), sizeof(size.y));
+  if (!file || magic != kTextureFileMagic || size.x == 0 || size.y == 0) {
+    return std::nullopt;
+  }
+  return size;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace ray_tracer {
+// Texels along a side of a texture tile. Tiles also store the first column
+// and row of their right and lower neighbors, wrapping around the edges, so
+// bilinear filtering never reads outside of a tile.
+constexpr unsigned int kTextureTileSize = 32;
+constexpr unsigned int kTextureTileStride = kTextureTileSize + 1;
+constexpr size_t kTextureTileTexels =
+    size_t{kTextureTileStride} * kTextureTileStride;
+constexpr size_t kTextureTileBytes = kTextureTileTexels * sizeof(uint32_t);
+
+// RGBA texels with 8 bits per channel, red in the lowest byte, rows one after
+// another.
+struct TextureImage {
+  unsigned int width;
+  unsigned int height;
+  std::vector<uint32_t> texels;
+};
+
+// A mip level of a tiled texture file.
+struct TextureLevel {
+  unsigned int width;
+  unsigned int height;
+  unsigned int tile_columns;
+  unsigned int tile_rows;
+  // Byte offset of the first tile in the file; tiles are stored row by row.
+  size_t offset;
+};
+
+// Binary PPM (P6) image with at most 8 bits per channel.
+std::optional<TextureImage> LoadPpm(const std::filesystem::path& path);
+
+// `squares` by `squares` checkerboard of `size` by `size` texels.
+TextureImage CreateCheckerboard(unsigned int size, unsigned int squares,
+                                uint32_t color_a, uint32_t color_b);
+
+// Mip levels of a texture, from `width` by `height` texels down to one.
+std::vector<TextureLevel> GetTextureLevels(unsigned int width,
+                                           unsigned int height);
+
+// Offline step: write the mip levels of `image`, each a box filtered half of
+// the previous one, as tiles of `kTextureTileSize` texels.
+bool WriteTiledTexture(const TextureImage& image,
+                       const std::filesystem::path& path);
+
+// Size of level 0 of a file written by `WriteTiledTexture`.
+std::optional<DirectX::XMUINT2> ReadTiledTextureSize(
+    const std::filesystem::path& path);
+}  // namespace ray_tracer
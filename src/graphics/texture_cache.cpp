@@ -0,0 +1,430 @@
+#include "texture_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+
+#include "../utils/trace.h"
+
+namespace {
+// 16 bits of texture index, 8 of level and 20 of each tile coordinate.
+inline uint64_t MakeTileKey(uint32_t texture, size_t level,
+                            unsigned int tile_x, unsigned int tile_y) {
+  return (static_cast<uint64_t>(texture) << 48U) |
+         (static_cast<uint64_t>(level) << 40U) |
+         (static_cast<uint64_t>(tile_y) << 20U) | tile_x;
+}
+
+inline uint32_t GetKeyTexture(uint64_t key) {
+  return static_cast<uint32_t>(key >> 48U);
+}
+
+inline size_t GetKeyLevel(uint64_t key) {
+  return static_cast<size_t>((key >> 40U) & 0xFFU);
+}
+
+inline unsigned int GetKeyTileX(uint64_t key) {
+  return static_cast<unsigned int>(key & 0xFFFFFU);
+}
+
+inline unsigned int GetKeyTileY(uint64_t key) {
+  return static_cast<unsigned int>((key >> 20U) & 0xFFFFFU);
+}
+
+// Shard of a tile; the multiplication spreads neighboring tiles.
+inline size_t GetShardIndex(uint64_t key, size_t shard_count) {
+  return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32U) %
+         shard_count;
+}
+
+inline DirectX::XMVECTOR LoadTexel(uint32_t texel) {
+  return DirectX::XMVectorScale(
+      DirectX::XMVectorSet(static_cast<float>(texel & 0xFFU),
+                           static_cast<float>((texel >> 8U) & 0xFFU),
+                           static_cast<float>((texel >> 16U) & 0xFFU),
+                           static_cast<float>(texel >> 24U)),
+      1.0f / 255.0f);
+}
+
+// Texel above and left of a sample position and the weights of its right and
+// lower neighbors.
+struct TexelPosition {
+  unsigned int x;
+  unsigned int y;
+  float weight_x;
+  float weight_y;
+};
+
+// `uv` is in `[0, 1)`.
+inline TexelPosition GetTexelPosition(const ray_tracer::TextureLevel& level,
+                                      DirectX::XMFLOAT2 uv) {
+  const float x = uv.x * static_cast<float>(level.width) - 0.5f;
+  const float y = uv.y * static_cast<float>(level.height) - 0.5f;
+  const float floor_x = std::floor(x);
+  const float floor_y = std::floor(y);
+  const auto wrap = [](float value, unsigned int size) {
+    return static_cast<unsigned int>(value < 0.0f ? value + size : value) %
+           size;
+  };
+  return {.x = wrap(floor_x, level.width),
+          .y = wrap(floor_y, level.height),
+          .weight_x = x - floor_x,
+          .weight_y = y - floor_y};
+}
+
+// Bilinear filter of the texels at `(x, y)` of a tile and their neighbors.
+inline DirectX::XMVECTOR FilterTile(const uint32_t* tile, unsigned int x,
+                                    unsigned int y, float weight_x,
+                                    float weight_y) {
+  const uint32_t* row =
+      tile + static_cast<size_t>(y) * ray_tracer::kTextureTileStride + x;
+  const uint32_t* next_row = row + ray_tracer::kTextureTileStride;
+  return DirectX::XMVectorLerp(
+      DirectX::XMVectorLerp(LoadTexel(row[0]), LoadTexel(row[1]), weight_x),
+      DirectX::XMVectorLerp(LoadTexel(next_row[0]), LoadTexel(next_row[1]),
+                            weight_x),
+      weight_y);
+}
+}  // namespace
+
+ray_tracer::TextureCache::TextureCache(size_t memory_budget,
+                                       unsigned int io_thread_count)
+    : slots_per_shard_(
+          std::max(memory_budget / kTextureTileBytes / kShardCount, size_t{1})),
+      slots_(slots_per_shard_ * kShardCount),
+      texels_(slots_.size() * kTextureTileTexels) {
+  for (size_t shard_index = 0; shard_index < kShardCount; ++shard_index) {
+    auto& shard = shards_[shard_index];
+    shard.slots.reserve(slots_per_shard_);
+    for (size_t i = slots_per_shard_; i > 0; --i) {
+      shard.free_slots.push_back(
+          static_cast<uint32_t>(shard_index * slots_per_shard_ + i - 1));
+    }
+  }
+  for (auto i = 0U; i < io_thread_count; ++i) {
+    io_threads_.emplace_back(
+        [this](std::stop_token stop_token) { RunIoThread(stop_token); });
+  }
+}
+
+std::optional<uint32_t> ray_tracer::TextureCache::AddTexture(
+    const std::filesystem::path& path) {
+  const auto size = ReadTiledTextureSize(path);
+  if (!size.has_value()) {
+    return std::nullopt;
+  }
+
+  auto texture = std::make_unique<Texture>();
+  texture->path = path;
+  texture->levels = GetTextureLevels(size->x, size->y);
+  std::error_code error{};
+  const auto file_size = std::filesystem::file_size(path, error);
+  if (error ||
+      file_size < texture->levels.back().offset + kTextureTileBytes) {
+    return std::nullopt;
+  }
+
+  // The coarse levels are the fallback while finer tiles stream in.
+  texture->first_resident_level = static_cast<size_t>(std::distance(
+      texture->levels.begin(),
+      std::ranges::find_if(texture->levels, [](const auto& level) {
+        return level.tile_columns == 1 && level.tile_rows == 1;
+      })));
+  std::ifstream file(path, std::ios::binary);
+  for (size_t level = texture->first_resident_level;
+       level < texture->levels.size(); ++level) {
+    auto& tile = texture->resident_tiles.emplace_back(kTextureTileTexels);
+    file.seekg(static_cast<std::streamoff>(texture->levels[level].offset));
+    file.read(reinterpret_cast<char*>(tile.data()),
+              static_cast<std::streamsize>(kTextureTileBytes));
+  }
+  if (!file) {
+    return std::nullopt;
+  }
+
+  std::scoped_lock lock(requests_mutex_);
+  const auto removed = std::ranges::find(textures_, nullptr);
+  if (removed != textures_.end()) {
+    *removed = std::move(texture);
+    return static_cast<uint32_t>(removed - textures_.begin());
+  }
+  // Tile keys hold 16 bits of texture index.
+  if (textures_.size() > std::numeric_limits<uint16_t>::max()) {
+    return std::nullopt;
+  }
+  textures_.push_back(std::move(texture));
+  return static_cast<uint32_t>(textures_.size() - 1);
+}
+
+void ray_tracer::TextureCache::RemoveTexture(uint32_t texture) {
+  // Queued loads are dropped; the slots of loads in flight are freed when
+  // they complete.
+  std::vector<uint32_t> dropped_slots{};
+  {
+    std::scoped_lock lock(requests_mutex_);
+    std::erase_if(requests_, [&](const LoadRequest& request) {
+      if (GetKeyTexture(request.key) != texture) {
+        return false;
+      }
+      dropped_slots.push_back(request.slot);
+      return true;
+    });
+    textures_[texture].reset();
+    ++removed_textures_;
+  }
+
+  for (auto& shard : shards_) {
+    std::scoped_lock lock(shard.mutex);
+    std::erase_if(shard.slots, [&](const auto& entry) {
+      const auto [key, slot] = entry;
+      if (GetKeyTexture(key) != texture) {
+        return false;
+      }
+      if (slots_[slot].state == SlotState::kLoading) {
+        if (std::ranges::find(dropped_slots, slot) == dropped_slots.end()) {
+          return true;
+        }
+        --shard.loading_tiles;
+      } else {
+        Unlink(shard, slot);
+        if (slots_[slot].state == SlotState::kResident) {
+          --shard.resident_tiles;
+        }
+      }
+      shard.free_slots.push_back(slot);
+      return true;
+    });
+  }
+}
+
+DirectX::XMVECTOR ray_tracer::TextureCache::Sample(uint32_t texture_index,
+                                                   DirectX::XMFLOAT2 uv,
+                                                   float lod) {
+  return SampleTexture(texture_index, uv, lod, false);
+}
+
+DirectX::XMVECTOR ray_tracer::TextureCache::SampleExact(uint32_t texture_index,
+                                                        DirectX::XMFLOAT2 uv,
+                                                        float lod) {
+  assert(!io_threads_.empty());
+  return SampleTexture(texture_index, uv, lod, true);
+}
+
+DirectX::XMVECTOR ray_tracer::TextureCache::SampleTexture(
+    uint32_t texture_index, DirectX::XMFLOAT2 uv, float lod, bool wait) {
+  const auto& texture = *textures_[texture_index];
+  if (!std::isfinite(uv.x) || !std::isfinite(uv.y)) {
+    uv = {0.0f, 0.0f};
+  }
+  uv.x -= std::floor(uv.x);
+  uv.y -= std::floor(uv.y);
+
+  const auto max_lod = static_cast<float>(texture.levels.size() - 1);
+  lod = std::isnan(lod) ? 0.0f : std::clamp(lod, 0.0f, max_lod);
+  const auto level = static_cast<size_t>(lod);
+  const float weight = lod - static_cast<float>(level);
+  const auto color = SampleLevel(texture, texture_index, level, uv, wait);
+  if (weight == 0.0f || level + 1 == texture.levels.size()) {
+    return color;
+  }
+  return DirectX::XMVectorLerp(
+      color, SampleLevel(texture, texture_index, level + 1, uv, wait), weight);
+}
+
+ray_tracer::TextureCacheStats ray_tracer::TextureCache::GetStats() const {
+  TextureCacheStats stats{.resident_tiles = 0,
+                          .capacity_tiles = slots_.size(),
+                          .hits = 0,
+                          .misses = 0,
+                          .evictions = 0,
+                          .pending_loads = 0};
+  for (const auto& shard : shards_) {
+    std::scoped_lock lock(shard.mutex);
+    stats.resident_tiles += shard.resident_tiles;
+    stats.hits += shard.hits;
+    stats.misses += shard.misses;
+    stats.evictions += shard.evictions;
+    stats.pending_loads += shard.loading_tiles;
+  }
+  return stats;
+}
+
+DirectX::XMVECTOR ray_tracer::TextureCache::SampleLevel(
+    const Texture& texture, uint32_t texture_index, size_t level,
+    DirectX::XMFLOAT2 uv, bool wait) {
+  for (; level < texture.first_resident_level; ++level) {
+    const auto position = GetTexelPosition(texture.levels[level], uv);
+    const auto key =
+        MakeTileKey(texture_index, level, position.x / kTextureTileSize,
+                    position.y / kTextureTileSize);
+    auto& shard = shards_[GetShardIndex(key, kShardCount)];
+    std::unique_lock lock(shard.mutex);
+    auto it = shard.slots.find(key);
+    const auto is_resident = [&] {
+      return it != shard.slots.end() &&
+             slots_[it->second].state == SlotState::kResident;
+    };
+    if (is_resident()) {
+      ++shard.hits;
+    } else {
+      ++shard.misses;
+      if (it == shard.slots.end()) {
+        RequestTile(shard, key);
+        it = shard.slots.find(key);
+      }
+      // The tile may be evicted again before this thread wakes up, or have
+      // found no slot, so request it until it is resident or failed.
+      while (wait && (it == shard.slots.end() ||
+                      slots_[it->second].state == SlotState::kLoading)) {
+        shard.tile_loaded.wait(lock);
+        it = shard.slots.find(key);
+        if (it == shard.slots.end()) {
+          RequestTile(shard, key);
+          it = shard.slots.find(key);
+        }
+      }
+      if (!is_resident()) {
+        continue;
+      }
+    }
+
+    Unlink(shard, it->second);
+    LinkFront(shard, it->second);
+    return FilterTile(&texels_[it->second * kTextureTileTexels],
+                      position.x % kTextureTileSize,
+                      position.y % kTextureTileSize, position.weight_x,
+                      position.weight_y);
+  }
+
+  const auto position = GetTexelPosition(texture.levels[level], uv);
+  return FilterTile(
+      texture.resident_tiles[level - texture.first_resident_level].data(),
+      position.x, position.y, position.weight_x, position.weight_y);
+}
+
+bool ray_tracer::TextureCache::RequestTile(Shard& shard, uint64_t key) {
+  const uint32_t slot = AcquireSlot(shard);
+  if (slot == kNoSlot) {
+    return false;
+  }
+  slots_[slot] = {.key = key,
+                  .state = SlotState::kLoading,
+                  .previous = kNoSlot,
+                  .next = kNoSlot};
+  shard.slots.emplace(key, slot);
+  ++shard.loading_tiles;
+  std::scoped_lock requests_lock(requests_mutex_);
+  requests_.push_back({key, slot});
+  requests_available_.notify_one();
+  return true;
+}
+
+uint32_t ray_tracer::TextureCache::AcquireSlot(Shard& shard) {
+  if (!shard.free_slots.empty()) {
+    const uint32_t slot = shard.free_slots.back();
+    shard.free_slots.pop_back();
+    return slot;
+  }
+
+  const uint32_t slot = shard.lru_tail;
+  if (slot == kNoSlot) {
+    return kNoSlot;
+  }
+  Unlink(shard, slot);
+  shard.slots.erase(slots_[slot].key);
+  if (slots_[slot].state == SlotState::kResident) {
+    --shard.resident_tiles;
+    ++shard.evictions;
+  }
+  return slot;
+}
+
+void ray_tracer::TextureCache::LinkFront(Shard& shard, uint32_t slot) {
+  slots_[slot].previous = kNoSlot;
+  slots_[slot].next = shard.lru_head;
+  if (shard.lru_head != kNoSlot) {
+    slots_[shard.lru_head].previous = slot;
+  } else {
+    shard.lru_tail = slot;
+  }
+  shard.lru_head = slot;
+}
+
+void ray_tracer::TextureCache::Unlink(Shard& shard, uint32_t slot) {
+  const uint32_t previous = slots_[slot].previous;
+  const uint32_t next = slots_[slot].next;
+  (previous != kNoSlot ? slots_[previous].next : shard.lru_head) = next;
+  (next != kNoSlot ? slots_[next].previous : shard.lru_tail) = previous;
+}
+
+void ray_tracer::TextureCache::RunIoThread(std::stop_token stop_token) {
+  utils::trace::SetThreadName("texture io");
+  // Files are opened on first use and kept open by each thread.
+  std::vector<std::ifstream> files{};
+  uint64_t removed_textures = 0;
+  while (true) {
+    LoadRequest request{};
+    uint32_t texture_index = 0;
+    std::shared_ptr<const Texture> texture{};
+    {
+      std::unique_lock lock(requests_mutex_);
+      if (!requests_available_.wait(lock, stop_token,
+                                    [this] { return !requests_.empty(); })) {
+        return;
+      }
+      request = requests_.front();
+      requests_.pop_front();
+      texture_index = GetKeyTexture(request.key);
+      texture = textures_[texture_index];
+      // Files of removed textures must not stay open, and their indices may
+      // now belong to other files.
+      if (removed_textures != removed_textures_) {
+        removed_textures = removed_textures_;
+        files.clear();
+      }
+    }
+
+    // The slot is not in the LRU list while loading, so nobody else touches
+    // its texels.
+    if (files.size() <= texture_index) {
+      files.resize(texture_index + 1);
+    }
+    auto& file = files[texture_index];
+    bool loaded = false;
+    {
+      auto scope = utils::trace::Scope("load texture tile");
+      if (!file.is_open()) {
+        file.open(texture->path, std::ios::binary);
+      }
+      file.clear();
+      const auto& level = texture->levels[GetKeyLevel(request.key)];
+      const size_t tile_index =
+          static_cast<size_t>(GetKeyTileY(request.key)) * level.tile_columns +
+          GetKeyTileX(request.key);
+      file.seekg(static_cast<std::streamoff>(level.offset +
+                                             tile_index * kTextureTileBytes));
+      file.read(reinterpret_cast<char*>(
+                    &texels_[request.slot * kTextureTileTexels]),
+                static_cast<std::streamsize>(kTextureTileBytes));
+      loaded = static_cast<bool>(file);
+    }
+
+    auto& shard = shards_[request.slot / slots_per_shard_];
+    std::scoped_lock lock(shard.mutex);
+    --shard.loading_tiles;
+    shard.tile_loaded.notify_all();
+    // The texture was removed while the tile loaded.
+    const auto it = shard.slots.find(request.key);
+    if (it == shard.slots.end() || it->second != request.slot) {
+      shard.free_slots.push_back(request.slot);
+      continue;
+    }
+    slots_[request.slot].state =
+        loaded ? SlotState::kResident : SlotState::kFailed;
+    if (loaded) {
+      ++shard.resident_tiles;
+    }
+    LinkFront(shard, request.slot);
+  }
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "texture.h"
+
+namespace ray_tracer {
+struct TextureCacheStats {
+  size_t resident_tiles;
+  size_t capacity_tiles;
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+  size_t pending_loads;
+};
+
+// Samples textures written by `WriteTiledTexture` through a fixed number of
+// tile slots, so texture memory stays within the budget whatever the size of
+// the textures. Missing tiles are read on background I/O threads and replace
+// the least recently used ones; meanwhile the finest resident coarser level
+// stands in. Levels that fit into a single tile stay resident.
+class TextureCache {
+ public:
+  TextureCache(size_t memory_budget, unsigned int io_thread_count);
+
+  TextureCache(const TextureCache&) = delete;
+  TextureCache& operator=(const TextureCache&) = delete;
+
+  // Register a tiled texture file. Not to be called while other threads
+  // sample. Returns the index of the texture, possibly one of a removed
+  // texture, or nothing if the file is invalid or 65536 textures are in use.
+  std::optional<uint32_t> AddTexture(const std::filesystem::path& path);
+
+  // Drop a texture along with its tiles and close its file. Not to be called
+  // while other threads sample.
+  void RemoveTexture(uint32_t texture);
+
+  // Texels of level 0 of `texture`.
+  inline DirectX::XMUINT2 GetSize(uint32_t texture) const {
+    const auto& level = textures_[texture]->levels.front();
+    return {level.width, level.height};
+  }
+
+  // Trilinear sample at `uv`, which wraps around; `lod` selects the mip level,
+  // 0 being the full texture. Thread-safe.
+  DirectX::XMVECTOR Sample(uint32_t texture, DirectX::XMFLOAT2 uv, float lod);
+
+  // Like `Sample`, but waits for missing tiles instead of reading a coarser
+  // level, so the result does not depend on which tiles are resident. Needs
+  // I/O threads.
+  DirectX::XMVECTOR SampleExact(uint32_t texture, DirectX::XMFLOAT2 uv,
+                                float lod);
+
+  TextureCacheStats GetStats() const;
+
+ private:
+  static constexpr uint32_t kNoSlot = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t kShardCount = 16;
+
+  struct Texture {
+    std::filesystem::path path;
+    std::vector<TextureLevel> levels;
+    // First level with a single tile; it and the coarser ones stay resident.
+    size_t first_resident_level;
+    std::vector<std::vector<uint32_t>> resident_tiles;
+  };
+
+  enum class SlotState { kLoading, kResident, kFailed };
+
+  // Tile in a slot, guarded by the shard the slot belongs to.
+  struct Slot {
+    uint64_t key;
+    SlotState state;
+    // Neighbors in the LRU list of the shard.
+    uint32_t previous;
+    uint32_t next;
+  };
+
+  // Tiles are spread over shards, each with its own lock, slots and LRU list,
+  // so samplers on different threads rarely wait for each other.
+  struct alignas(64) Shard {
+    mutable std::mutex mutex;
+    // Notified whenever a load of the shard completes.
+    std::condition_variable tile_loaded;
+    std::unordered_map<uint64_t, uint32_t> slots;
+    std::vector<uint32_t> free_slots;
+    // Resident and failed slots, most recently used first; loading slots are
+    // not in the list, so they are never evicted.
+    uint32_t lru_head = kNoSlot;
+    uint32_t lru_tail = kNoSlot;
+    size_t resident_tiles = 0;
+    size_t loading_tiles = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+  };
+
+  struct LoadRequest {
+    uint64_t key;
+    uint32_t slot;
+  };
+
+  DirectX::XMVECTOR SampleTexture(uint32_t texture_index, DirectX::XMFLOAT2 uv,
+                                  float lod, bool wait);
+
+  // Bilinear sample of `level`, or of the finest coarser level whose tile is
+  // resident. With `wait`, missing tiles are waited for, and only failed ones
+  // fall back.
+  DirectX::XMVECTOR SampleLevel(const Texture& texture, uint32_t texture_index,
+                                size_t level, DirectX::XMFLOAT2 uv, bool wait);
+
+  // Queue a load of tile `key` into a slot of `shard`, whose mutex the caller
+  // holds. False if every slot of the shard is loading.
+  bool RequestTile(Shard& shard, uint64_t key);
+
+  // Slot for a new tile of `shard`: a free one, or else the least recently
+  // used one. `kNoSlot` if every slot is loading.
+  uint32_t AcquireSlot(Shard& shard);
+
+  void LinkFront(Shard& shard, uint32_t slot);
+
+  void Unlink(Shard& shard, uint32_t slot);
+
+  void RunIoThread(std::stop_token stop_token);
+
+  // Null for removed textures. Shared with I/O threads that load their tiles.
+  std::vector<std::shared_ptr<const Texture>> textures_;
+  size_t slots_per_shard_;
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> texels_;
+  std::array<Shard, kShardCount> shards_;
+  std::mutex requests_mutex_;
+  std::condition_variable_any requests_available_;
+  std::deque<LoadRequest> requests_;
+  // Textures removed so far; I/O threads close their files when it changes.
+  uint64_t removed_textures_ = 0;
+  // Declared last, so the threads stop before the state they use goes away.
+  std::vector<std::jthread> io_threads_;
+};
+}  // namespace ray_tracer
@@ -0,0 +1,89 @@
+#include "tile_culling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "../utils/frame_arena.h"
+#include "camera_ray.h"
+
+namespace {
+// Anything farther away than this is not rendered anyway.
+constexpr auto kFarPlane = 1.0e6f;
+
+// Build the frustum of a tile in a space looking down `+z`, which is the
+// camera space rotated by 180 degrees around `y`.
+DirectX::BoundingFrustum CreateTileFrustum(const ray_tracer::Tile& tile,
+                                           int width, int height) {
+  const auto top_left = ray_tracer::GetCameraPlanePoint(
+      static_cast<float>(tile.x), static_cast<float>(tile.y), width, height);
+  const auto bottom_right = ray_tracer::GetCameraPlanePoint(
+      static_cast<float>(tile.x + tile.width),
+      static_cast<float>(tile.y + tile.height), width, height);
+
+  // Primary hits closer than 1 along a unit direction are rejected, so the
+  // near plane may sit at the depth of that distance along the widest ray.
+  const float max_x =
+      std::fmaxf(std::abs(top_left.x), std::abs(bottom_right.x));
+  const float max_y =
+      std::fmaxf(std::abs(top_left.y), std::abs(bottom_right.y));
+  const float near_plane =
+      0.99f / std::sqrt(max_x * max_x + max_y * max_y + 1.0f);
+
+  return DirectX::BoundingFrustum(
+      DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f),
+      DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), -top_left.x, -bottom_right.x,
+      top_left.y, bottom_right.y, near_plane, kFarPlane);
+}
+}  // namespace
+
+ray_tracer::TileGrid::TileGrid(unsigned int width, unsigned int height,
+                               unsigned int tile_size,
+                               utils::numa::ThreadPool& thread_pool)
+    : width_(width),
+      height_(height),
+      tile_size_(tile_size),
+      columns_((width + tile_size - 1) / tile_size),
+      thread_pool_(thread_pool) {
+  const unsigned int rows = (height + tile_size - 1) / tile_size;
+  tiles_.reserve(static_cast<size_t>(rows) * columns_);
+  for (auto row = 0U; row < rows; ++row) {
+    for (auto column = 0U; column < columns_; ++column) {
+      Tile tile{};
+      tile.x = column * tile_size;
+      tile.y = row * tile_size;
+      tile.width = std::min(tile_size, width - tile.x);
+      tile.height = std::min(tile_size, height - tile.y);
+      tiles_.push_back(std::move(tile));
+    }
+  }
+}
+
+void ray_tracer::TileGrid::Cull(
+    DirectX::FXMMATRIX camera_to_world_matrix,
+    std::span<const DirectX::BoundingBox> mesh_bounds) {
+  const DirectX::XMMATRIX frustum_to_world = DirectX::XMMatrixMultiply(
+      DirectX::XMMatrixRotationY(std::numbers::pi_v<float>),
+      camera_to_world_matrix);
+
+  thread_pool_.ParallelFor(
+      tiles_.size(), columns_, [&](size_t begin, size_t end) {
+        for (size_t tile_index = begin; tile_index < end; ++tile_index) {
+          auto& tile = tiles_[tile_index];
+          CreateTileFrustum(tile, static_cast<int>(width_),
+                            static_cast<int>(height_))
+              .Transform(tile.frustum, frustum_to_world);
+
+          const auto mesh_indices =
+              utils::memory::AllocateFrameArray<uint32_t>(mesh_bounds.size());
+          size_t mesh_count = 0;
+          for (size_t mesh_index = 0; mesh_index < mesh_bounds.size();
+               ++mesh_index) {
+            if (tile.frustum.Intersects(mesh_bounds[mesh_index])) {
+              mesh_indices[mesh_count++] = static_cast<uint32_t>(mesh_index);
+            }
+          }
+          tile.mesh_indices = mesh_indices.first(mesh_count);
+        }
+      });
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../utils/numa.h"
+
+namespace ray_tracer {
+// A rectangle of pixels and the meshes and primitives its primary rays can
+// hit, indexed as in `Hit::mesh_index`.
+struct Tile {
+  unsigned int x;
+  unsigned int y;
+  unsigned int width;
+  unsigned int height;
+  DirectX::BoundingFrustum frustum;
+  // In the frame arena of the culling thread, valid until the next frame.
+  std::span<const uint32_t> mesh_indices;
+};
+
+// Splits the image into tiles and culls the bounds of meshes and primitives
+// against the frustum spanned by each tile's corner rays, one row of tiles per
+// task of `thread_pool`.
+class TileGrid {
+ public:
+  TileGrid(unsigned int width, unsigned int height, unsigned int tile_size,
+           utils::numa::ThreadPool& thread_pool);
+
+  void Cull(DirectX::FXMMATRIX camera_to_world_matrix,
+            std::span<const DirectX::BoundingBox> mesh_bounds);
+
+  // Tile containing pixel `(x, y)`.
+  inline const Tile& At(unsigned int x, unsigned int y) const {
+    return tiles_[(y / tile_size_) * columns_ + x / tile_size_];
+  }
+
+  inline std::span<Tile> Tiles() { return tiles_; }
+
+  inline std::span<const Tile> Tiles() const { return tiles_; }
+
+  inline unsigned int TileSize() const { return tile_size_; }
+
+ private:
+  unsigned int width_;
+  unsigned int height_;
+  unsigned int tile_size_;
+  unsigned int columns_;
+  utils::numa::ThreadPool& thread_pool_;
+  std::vector<Tile> tiles_;
+};
+}  // namespace ray_tracer
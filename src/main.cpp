@@ -4,57 +4,56 @@
 #include <Windows.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <bitset>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
 #include <numbers>
 #include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "common/image.h"
 #include "common/matrix_view.h"
+#include "common/snapshot_buffer.h"
+#include "graphics/adaptive_sampler.h"
+#include "graphics/ambient_occlusion.h"
+#include "graphics/camera_ray.h"
+#include "graphics/denoiser.h"
+#include "graphics/image_sampling.h"
+#include "graphics/multi_view.h"
+#include "graphics/path_tracer.h"
+#include "graphics/quality_controller.h"
+#include "graphics/rasterizer.h"
+#include "graphics/ray_query.h"
 #include "graphics/ray_tracer.h"
+#include "graphics/texture.h"
+#include "graphics/texture_cache.h"
+#include "graphics/tile_culling.h"
 #include "scene/fps_camera.h"
+#include "scene/geometry_streamer.h"
+#include "scene/live_scene.h"
 #include "scene/mesh.h"
-#include "scene/mesh_view.h"
+#include "scene/scene_description.h"
+#include "scene/scene_geometry.h"
+#include "utils/file_watcher.h"
+#include "utils/frame_arena.h"
+#include "utils/numa.h"
+#include "utils/temp_directory.h"
+#include "utils/trace.h"
 #include "utils/win32.h"
 #include "utils/xm.h"
 
-namespace {
-inline void CreateCameraRay(DirectX::XMVECTOR& out_origin,
-                            DirectX::XMVECTOR& out_direction, unsigned int x,
-                            unsigned int y, int width, int height,
-                            const DirectX::XMMATRIX& camera_to_world_matrix) {
-  // Calculate half of the horizontal field of view angle (in radians).
-  const float fov_horizontal = std::numbers::pi_v<float> / 2.0f;
-  const float half_angle_tan = std::tan(fov_horizontal / 2.0f);
-
-  // Calculate the inverse aspect ratio.
-  const float aspect_ratio =
-      static_cast<float>(width) / static_cast<float>(height);
-  const float inverse_aspect_ratio = 1.0f / aspect_ratio;
-
-  const float ndc_x = std::lerp(
-      -1.0f, 1.0f, (static_cast<float>(x) + 0.5f) / static_cast<float>(width));
-  const float ndc_y = std::lerp(
-      1.0f, -1.0f, (static_cast<float>(y) + 0.5f) / static_cast<float>(height));
-
-  const float camera_x = half_angle_tan * ndc_x;
-  const float camera_y = inverse_aspect_ratio * half_angle_tan * ndc_y;
-
-  const DirectX::XMVECTOR camera_ndc =
-      DirectX::XMVectorSet(camera_x, camera_y, -1.0f, 0.0f);
-
-  const DirectX::XMVECTOR xm_world_origin =
-      DirectX::XMVector3Transform(DirectX::g_XMZero, camera_to_world_matrix);
-  const DirectX::XMVECTOR xm_world_target =
-      DirectX::XMVector3Transform(camera_ndc, camera_to_world_matrix);
-
-  out_origin = xm_world_origin;
-  out_direction = DirectX::XMVector3Normalize(
-      DirectX::XMVectorSubtract(xm_world_target, xm_world_origin));
-}
-}  // namespace
-
 int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev_instance,
                     _In_ PWSTR cmd_line, _In_ int cmd_show) {
   UNREFERENCED_PARAMETER(cmd_line);
@@ -68,9 +67,21 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev_instance,
   HWND window =
       utils::win32::CreateMainWindow(instance, kDoubleWidth, kDoubleHeight);
 
-  std::vector<UINT16> frame_buffer(kDoubleWidth * kDoubleHeight, UINT16{});
+  utils::trace::SetThreadName("main");
+  // Frames per trace capture, started with F6.
+  constexpr auto kTraceFrames = 120U;
+  const auto trace_path =
+      std::filesystem::temp_directory_path() / "ray_tracer_trace.json";
+
+  // Render workers pinned to the processors of each NUMA node.
+  auto render_pool = utils::numa::ThreadPool(utils::numa::GetNodes());
+
+  // Two pages on top of each other, so each one is contiguous. Pages of the
+  // frame buffer are first touched by the workers that write their rows.
+  auto frame_buffer =
+      utils::numa::FirstTouchBuffer<UINT16>(2 * kWidth * kHeight);
   auto frame_buffer_view =
-      MatrixView<UINT16>(frame_buffer, kDoubleWidth, kDoubleHeight);
+      MatrixView<UINT16>(frame_buffer.Elements(), 2 * kHeight, kWidth);
   auto front_buffer = frame_buffer_view.Submatrix(0, 0, kHeight, kWidth);
   auto back_buffer = frame_buffer_view.Submatrix(kHeight, 0, kHeight, kWidth);
   BITMAPINFO bmi = {};
@@ -81,65 +92,605 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev_instance,
   bmi.bmiHeader.biBitCount = 16;
   bmi.bmiHeader.biClrUsed = BI_RGB;
 
-  std::vector<DirectX::XMUINT2> pixels(kWidth * kHeight);
-  for (auto y = 0U; y < kHeight; ++y) {
-    for (auto x = 0U; x < kWidth; ++x) {
-      pixels[static_cast<size_t>(y) * kWidth + x] = {x, y};
+  // Frames are converted one tile per task, so that neighbouring pixels share
+  // cache lines, and linearized into a page for StretchDIBits.
+  auto frame_tiles = Image<UINT16>(kHeight, kWidth, ImageLayout::kMorton);
+  const size_t frame_tile_size = frame_tiles.TileSize();
+  const size_t frame_tile_columns =
+      (kWidth + frame_tile_size - 1) / frame_tile_size;
+  const size_t frame_tile_rows =
+      (kHeight + frame_tile_size - 1) / frame_tile_size;
+
+  auto fps_camera = scene::FpsCamera();
+  std::vector<DirectX::XMFLOAT3A> light_positions{};
+
+  // Levels of detail and materials baked by this process. Declared before
+  // the streamer and the cache, so that they close the files before the
+  // directory goes away.
+  const auto temp_directory = utils::file::TempDirectory(
+      std::filesystem::temp_directory_path() /
+      ("ray_tracer_" + std::to_string(GetCurrentProcessId())));
+
+  // The scene comes from a text file and is reloaded whenever the file
+  // changes; only the instances and materials that changed are rebuilt.
+  // Levels of detail of the static meshes are baked and streamed from disk;
+  // spinning meshes stay resident.
+  constexpr size_t kLodLevels = 4;
+  constexpr size_t kGeometryBudget = 64 * 1024 * 1024;
+  auto geometry_streamer = scene::GeometryStreamer(kGeometryBudget, 2);
+  auto live_scene =
+      scene::LiveScene(geometry_streamer, temp_directory.Path(), kLodLevels);
+
+  // Materials are baked into tiled mip levels and sampled through a cache
+  // much smaller than the textures.
+  constexpr size_t kTextureCacheBudget = 2 * 1024 * 1024;
+  auto texture_cache = ray_tracer::TextureCache(kTextureCacheBudget, 1);
+
+  // Textures cannot be added while rays sample them, so this thread loads the
+  // description and bakes its materials between frames; the simulation thread
+  // picks it up and rebuilds the meshes.
+  struct SceneReload {
+    // Counts the loads, this one included; the snapshots of its scene carry
+    // it as their scene version.
+    uint64_t version;
+    scene::SceneDescription description;
+    std::vector<uint32_t> material_textures;
+  };
+  constexpr auto kScenePollInterval = 250;
+  auto scene_watcher = utils::file::FileWatcher("scene.txt");
+  LONGLONG scene_poll_time = utils::win32::GetMilliseconds();
+  // Owned by this thread: the last loaded description, the textures of its
+  // materials and the error of the last load, e.g. a material without a
+  // texture, empty if there was none.
+  scene::SceneDescription loaded_description{};
+  std::vector<uint32_t> material_textures{};
+  uint64_t loaded_version = 0;
+  size_t baked_textures = 0;
+  std::string scene_error{};
+  // Files of the textures, and the textures of replaced materials along with
+  // the version of the load that replaced them. They are removed once the
+  // renderer shows that version, so no ray samples them anymore.
+  std::vector<std::filesystem::path> texture_paths{};
+  struct RetiredTexture {
+    uint64_t version;
+    uint32_t texture;
+  };
+  std::vector<RetiredTexture> retired_textures{};
+  std::mutex scene_reload_mutex;
+  std::optional<SceneReload> scene_reload{};
+  const auto bake_material =
+      [&](const scene::MaterialDescription& material) -> uint32_t {
+        for (const auto& source : material.sources) {
+          std::optional<ray_tracer::TextureImage> image{};
+          switch (source.type) {
+            case scene::MaterialSourceType::kImage:
+              image = ray_tracer::LoadPpm(source.path);
+              break;
+            case scene::MaterialSourceType::kChecker:
+              image = ray_tracer::CreateCheckerboard(
+                  source.size, source.squares, source.color_a, source.color_b);
+              break;
+            case scene::MaterialSourceType::kColor:
+              image = ray_tracer::CreateCheckerboard(8, 1, source.color_a,
+                                                     source.color_a);
+              break;
+          }
+          if (!image.has_value()) {
+            continue;
+          }
+          // Every bake gets a new file; the cache may still read old ones.
+          const auto texture_path =
+              temp_directory.Path() /
+              ("material_" + std::to_string(baked_textures++) + ".rtt");
+          if (!ray_tracer::WriteTiledTexture(*image, texture_path)) {
+            continue;
+          }
+          if (const auto texture = texture_cache.AddTexture(texture_path)) {
+            if (texture_paths.size() <= *texture) {
+              texture_paths.resize(*texture + 1);
+            }
+            texture_paths[*texture] = texture_path;
+            return *texture;
+          }
+          std::error_code error{};
+          std::filesystem::remove(texture_path, error);
+        }
+        return scene::SceneGeometry::kNoTexture;
+      };
+  const auto load_scene = [&]() -> std::optional<SceneReload> {
+    auto scope = utils::trace::Scope("load scene");
+    auto description =
+        scene::LoadSceneDescription(scene_watcher.Path(), scene_error);
+    if (!description.has_value()) {
+      return std::nullopt;
     }
+    const auto diff =
+        scene::DiffSceneDescriptions(loaded_description, *description);
+    ++loaded_version;
+    scene_error.clear();
+    std::vector<uint32_t> textures(description->materials.size());
+    std::vector<bool> kept_textures(material_textures.size(), false);
+    for (size_t i = 0; i < textures.size(); ++i) {
+      const auto& material = description->materials[i];
+      if (const auto& kept = diff.kept_materials[i]) {
+        textures[i] = material_textures[*kept];
+        kept_textures[*kept] = true;
+        continue;
+      }
+      textures[i] = bake_material(material);
+      if (textures[i] == scene::SceneGeometry::kNoTexture) {
+        scene_error = "no texture for material " + material.name;
+      }
+    }
+    for (size_t i = 0; i < material_textures.size(); ++i) {
+      if (!kept_textures[i] &&
+          material_textures[i] != scene::SceneGeometry::kNoTexture) {
+        retired_textures.push_back(
+            {.version = loaded_version, .texture = material_textures[i]});
+      }
+    }
+    loaded_description = *description;
+    material_textures = textures;
+    return SceneReload{loaded_version, std::move(*description),
+                       std::move(textures)};
+  };
+
+  // Owned by the simulation thread: the description the live scene was built
+  // from, and the version of its load.
+  scene::SceneDescription applied_description{};
+  uint64_t scene_version = 0;
+  const auto apply_scene = [&](const SceneReload& reload) {
+    auto scope = utils::trace::Scope("apply scene");
+    const auto& description = reload.description;
+    const auto diff =
+        scene::DiffSceneDescriptions(applied_description, description);
+    live_scene.Apply(description, diff, reload.material_textures);
+    if (diff.camera_changed && description.camera.has_value()) {
+      const auto& camera = *description.camera;
+      fps_camera =
+          scene::FpsCamera(camera.position, camera.pitch, camera.yaw);
+    }
+    light_positions = description.light_positions;
+    applied_description = description;
+    scene_version = reload.version;
+  };
+  if (const auto reload = load_scene()) {
+    apply_scene(*reload);
   }
 
-  std::vector<
-      std::pair<std::vector<DirectX::XMFLOAT3A>, std::vector<DirectX::XMINT3>>>
-      meshes{};
-  meshes.push_back(scene::LoadCube());
-  meshes.push_back(scene::LoadCube());
-  meshes.push_back(scene::LoadCube());
-  meshes.push_back(scene::LoadOctahedron());
-  meshes.push_back(scene::LoadRectangle());
-  meshes.push_back(scene::LoadRectangle());
-
-  auto cube_1 = scene::MeshView(meshes[0].first, meshes[0].second);
-  auto cube_2 = scene::MeshView(meshes[1].first, meshes[1].second);
-  auto cube_3 = scene::MeshView(meshes[2].first, meshes[2].second);
-  auto octahedron = scene::MeshView(meshes[3].first, meshes[3].second);
-  auto rectangle_1 = scene::MeshView(meshes[4].first, meshes[4].second);
-  auto rectangle_2 = scene::MeshView(meshes[5].first, meshes[5].second);
-
-  cube_1.Translate(0.0f, 0.0f, -4.0f);
-  cube_2.Translate(0.0f, 2.0f, -8.0f);
-  cube_3.Rotate(0.0f, 0.2f, 0.0f)
-      .Scale(3.0f, 3.0f, 3.0f)
-      .Translate(0.0f, -2.0f, -16.0f);
-  octahedron.Rotate(0.2f, 0.2f, 0.1f)
-      .Scale(1.0f, 1.0f, 1.0f)
-      .Translate(0.0f, 2.0f, -32.0f);
-  rectangle_1.Rotate(3.14f / 2.0f, 0.0f, 0.0f)
-      .Scale(256.0f, 1.0f, 256.0f)
-      .Translate(0.0f, -8.0f, -2.0f);
-  rectangle_2.Scale(256.0f, 256.0f, 1.0f).Translate(0.0f, 120.0f, -130.0f);
+  // Ambient occlusion of world space cells, filled a few rays per cell and
+  // frame and kept while the camera moves.
+  constexpr size_t kAmbientOcclusionBudget = 4 * 1024 * 1024;
+  auto ambient_occlusion_cache = ray_tracer::AmbientOcclusionCache(
+      kAmbientOcclusionBudget, {.radius = 4.0f,
+                                .min_cell_size = 0.125f,
+                                .cell_pixels = 4.0f,
+                                .max_samples = 64,
+                                .samples_per_frame = 4});
+
+  // Pixels per unit at distance 1.
+  const float projection_scale =
+      static_cast<float>(kWidth) /
+      (2.0f * ray_tracer::GetCameraPlanePoint(static_cast<float>(kWidth), 0.0f,
+                                              kWidth, kHeight)
+                  .x);
+
+  // Rasterize primary visibility instead of tracing camera rays.
+  bool rasterized_visibility = false;
 
   constexpr auto kFps = 30;
   bool running = true;
   auto page = 0U;
   constexpr auto kSimulationTimeStep = 1000 / kFps;
-  LONGLONG simulation_time = 0;
   std::bitset<256> key_states{};
   std::bitset<256> prev_key_states{};
-  auto fps_camera = scene::FpsCamera();
   DirectX::XMVECTOR light_position =
       DirectX::XMVectorSet(0.0f, 0.0f, 0.1f, 0.0f);
 
-  std::array<DirectX::XMFLOAT3A, 2> light_positions = {
-      DirectX::XMFLOAT3A(0.0f, 0.0f, -1.0f),
-      DirectX::XMFLOAT3A(0.0f, 4.0f, -8.0f)};
-
   auto shadow_visibility = ray_tracer::ShadowVisibility::Hidden;
   auto reflection_visibility = ray_tracer::ReflectionVisibility::Hidden;
 
+  bool anti_aliasing = true;
+  // Edge-aware filtering of the rendered colors.
+  bool denoising = false;
+  // Ambient light darkened by occluders near the surface.
+  bool ambient_occlusion = false;
+  // Progressive path tracing instead of the real-time renderer.
+  bool path_tracing = false;
+  // Several views of the scene rendered in one pass, side by side.
+  enum class ViewLayout { Single, Stereo, CubeMap };
+  auto view_layout = ViewLayout::Single;
+
+  // Quality levels from the best to the cheapest: fewer edge samples first,
+  // then a lower internal resolution, then fewer secondary rays. Each is
+  // {resolution scale, max samples per pixel, rays per pixel, secondary depth}.
+  const std::vector<ray_tracer::QualityLevel> quality_levels = {
+      {1.0f, 8, 1.5f, 2},   {1.0f, 4, 1.25f, 2}, {1.0f, 1, 1.0f, 2},
+      {0.75f, 4, 1.25f, 2}, {0.75f, 1, 1.0f, 2}, {0.75f, 1, 1.0f, 1},
+      {0.5f, 1, 1.0f, 1},   {0.5f, 1, 1.0f, 0},
+  };
+
+  // Leave a fifth of the frame to presenting.
+  constexpr auto kTargetFrameTime = 0.8f * 1000.0f / kFps;
+  auto quality_controller =
+      ray_tracer::QualityController({.target_frame_time = kTargetFrameTime,
+                                     .upgrade_threshold = 0.7f,
+                                     .overrun_threshold = 1.5f,
+                                     .smoothing = 0.2f,
+                                     .cooldown_frames = 8},
+                                    quality_levels);
+
+  // Renderers for each internal resolution of the quality levels.
+  struct RenderTarget {
+    float resolution_scale;
+    unsigned int width;
+    unsigned int height;
+    ray_tracer::TileGrid tile_grid;
+    ray_tracer::Rasterizer rasterizer;
+    ray_tracer::AdaptiveSampler sampler;
+    ray_tracer::Denoiser denoiser;
+  };
+  constexpr auto kTileSize = 16U;
+  std::vector<std::unique_ptr<RenderTarget>> render_targets{};
+  for (const auto& level : quality_levels) {
+    if (!render_targets.empty() &&
+        render_targets.back()->resolution_scale == level.resolution_scale) {
+      continue;
+    }
+    const auto width =
+        static_cast<unsigned int>(kWidth * level.resolution_scale);
+    const auto height =
+        static_cast<unsigned int>(kHeight * level.resolution_scale);
+    render_targets.push_back(std::unique_ptr<RenderTarget>(new RenderTarget{
+        level.resolution_scale, width, height,
+        ray_tracer::TileGrid(width, height, kTileSize, render_pool),
+        ray_tracer::Rasterizer(width, height, kTileSize, render_pool),
+        ray_tracer::AdaptiveSampler(width, height,
+                                    {.ray_budget = width * height,
+                                     .max_samples_per_pixel = 1,
+                                     .color_threshold = 0.1f,
+                                     .depth_threshold = 0.05f},
+                                    render_pool),
+        ray_tracer::Denoiser(width, height,
+                             {.iterations = 3,
+                              .color_sigma = 0.1f,
+                              .depth_sigma = 0.1f,
+                              .normal_power = 64.0f,
+                              .albedo_sigma = 0.05f},
+                             render_pool)}));
+  }
+  const auto get_render_target = [&](float resolution_scale) -> RenderTarget& {
+    return **std::ranges::find_if(render_targets, [&](const auto& target) {
+      return target->resolution_scale == resolution_scale;
+    });
+  };
+
+  // Global illumination at the output resolution, converging while the camera
+  // holds still.
+  auto path_tracer = ray_tracer::PathTracer(kWidth, kHeight,
+                                            {.samples_per_frame = 1,
+                                             .max_bounces = 4,
+                                             .roulette_bounces = 2,
+                                             .light_intensity = 40.0f,
+                                             .sky_radiance = 1.0f},
+                                            render_pool);
+  // Camera of the accumulated paths, empty when nothing is accumulated, and
+  // the versions of the scene and its streamed levels they saw.
+  std::optional<DirectX::XMFLOAT4X4A> path_camera{};
+  uint64_t path_scene_version = 0;
+  uint64_t path_level_version = 0;
+  const float path_spread_angle =
+      ray_tracer::GetPixelSpreadAngle(kWidth, kHeight);
+  // Cone angle of rays after a diffuse bounce, which scatter over the whole
+  // hemisphere. It keeps their texture lookups on coarse levels, so paths do
+  // not pull in the fine tiles of everything they bounce off.
+  constexpr auto kBounceSpreadAngle = 0.25f;
+
+  // A stereo pair side by side, or the faces of a cube map around the camera
+  // in three columns and two rows, all views of a layout in one pass.
+  constexpr auto kEyeSeparation = 0.5f;
+  constexpr auto kCubeMapSize = std::min(kWidth / 3, kHeight / 2);
+  auto stereo_renderer = ray_tracer::MultiViewRenderer(
+      ray_tracer::MakeStereoViews(DirectX::XMMatrixIdentity(), kEyeSeparation,
+                                  kWidth / 2, kHeight),
+      kTileSize, render_pool);
+  auto cube_map_renderer = ray_tracer::MultiViewRenderer(
+      ray_tracer::MakeCubeMapViews(DirectX::g_XMZero, kCubeMapSize), kTileSize,
+      render_pool);
+  // The views of a layout at the output resolution.
+  std::vector<DirectX::XMFLOAT3A> view_mosaic(kWidth * kHeight);
+
+  // Copies of the scene meshes in the memory of each node, along with the
+  // meshes they copy, so that only meshes that changed are copied again. Only
+  // worth it with more than one node.
+  const bool replicate_scene = render_pool.NodeCount() > 1;
+  struct SceneReplica {
+    std::vector<scene::SharedMesh> sources;
+    // Only read while this node renders, so changed meshes are copied over
+    // the old copies, which reuses their buffers.
+    std::vector<std::shared_ptr<scene::Mesh>> copies;
+    std::vector<scene::SharedMesh> meshes;
+  };
+  std::vector<SceneReplica> scene_replicas(render_pool.NodeCount());
+  std::shared_ptr<const scene::SceneGeometry> replicated_geometry{};
+
+  // Per-node throughput and quality decisions, shown in the window title once
+  // per second.
+  constexpr auto kStatsInterval = 1000;
+  LONGLONG stats_time = utils::win32::GetMilliseconds();
+  // Most global allocations of a frame, on any thread, since the last update.
+  uint64_t peak_frame_allocations = 0;
+
+  // Everything the renderer reads from the simulation. The simulation thread
+  // owns the live scene and publishes a copy after every update.
+  struct SceneSnapshot {
+    std::shared_ptr<const scene::SceneGeometry> geometry;
+    DirectX::XMFLOAT4X4A camera_to_world_matrix;
+    DirectX::XMFLOAT4X4A world_to_camera_matrix;
+    ray_tracer::ShadowVisibility shadow_visibility;
+    ray_tracer::ReflectionVisibility reflection_visibility;
+    bool anti_aliasing;
+    bool denoising;
+    bool rasterized_visibility;
+    bool ambient_occlusion;
+    bool path_tracing;
+    ViewLayout view_layout;
+    std::vector<DirectX::XMFLOAT3A> light_positions;
+    // Version of the load of the applied scene description, so it changes
+    // whenever a new one was applied.
+    uint64_t scene_version;
+    // Changes whenever a streamed level of detail was swapped in.
+    uint64_t level_version;
+    scene::LiveSceneStats scene_stats;
+  };
+  auto snapshots = SnapshotBuffer<SceneSnapshot>();
+  // Geometry of the latest snapshot, shared with ray queries, and the version
+  // of the live scene it was made from. Steps that change nothing publish the
+  // same geometry again; the others share the meshes that did not change.
+  std::shared_ptr<const scene::SceneGeometry> geometry{};
+  uint64_t geometry_version = 0;
+  // Geometries published so far. One that nothing else holds any more is
+  // overwritten in place, which reuses its buffers.
+  std::vector<std::shared_ptr<scene::SceneGeometry>> published_geometries{};
+  const auto publish_snapshot = [&] {
+    auto& snapshot = snapshots.Back();
+    if (geometry == nullptr || geometry_version != live_scene.Version()) {
+      auto unused = std::ranges::find_if(
+          published_geometries,
+          [](const auto& published) { return published.use_count() == 1; });
+      if (unused == published_geometries.end()) {
+        unused = published_geometries.insert(
+            unused, std::make_shared<scene::SceneGeometry>());
+      }
+      // Pairs with the release of the last other owner.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      auto& next_geometry = **unused;
+      next_geometry.meshes = live_scene.Meshes();
+      next_geometry.primitives = live_scene.Primitives();
+      next_geometry.bounds = live_scene.Bounds();
+      next_geometry.mesh_uvs = live_scene.Uvs();
+      next_geometry.textures = live_scene.Textures();
+      geometry = *unused;
+      geometry_version = live_scene.Version();
+    }
+    snapshot.geometry = geometry;
+    DirectX::XMStoreFloat4x4A(&snapshot.camera_to_world_matrix,
+                              fps_camera.GetCameraToWorldMatrix());
+    DirectX::XMStoreFloat4x4A(&snapshot.world_to_camera_matrix,
+                              fps_camera.GetWorldToCameraMatrix());
+    snapshot.shadow_visibility = shadow_visibility;
+    snapshot.reflection_visibility = reflection_visibility;
+    snapshot.anti_aliasing = anti_aliasing;
+    snapshot.denoising = denoising;
+    snapshot.rasterized_visibility = rasterized_visibility;
+    snapshot.ambient_occlusion = ambient_occlusion;
+    snapshot.path_tracing = path_tracing;
+    snapshot.view_layout = view_layout;
+    snapshot.light_positions = light_positions;
+    snapshot.scene_version = scene_version;
+    snapshot.level_version = live_scene.LevelVersion();
+    snapshot.scene_stats = live_scene.GetStats();
+    snapshots.Publish();
+  };
+  publish_snapshot();
+
+  // Line of sight from the camera to each light, queried by the simulation
+  // without waiting for the result. One mask word covers the first 64 lights.
+  constexpr size_t kMaxQueriedLights = 64;
+  struct LightRays {
+    size_t count;
+    std::array<float, kMaxQueriedLights> origin_x;
+    std::array<float, kMaxQueriedLights> origin_y;
+    std::array<float, kMaxQueriedLights> origin_z;
+    std::array<float, kMaxQueriedLights> direction_x;
+    std::array<float, kMaxQueriedLights> direction_y;
+    std::array<float, kMaxQueriedLights> direction_z;
+    std::array<float, kMaxQueriedLights> min_distance;
+    std::array<float, kMaxQueriedLights> max_distance;
+    std::array<uint64_t, 1> occluded;
+  };
+  LightRays light_rays{};
+  std::atomic<bool> light_query_pending = false;
+  std::atomic<size_t> queried_lights = 0;
+  std::atomic<uint64_t> occluded_lights = 0;
+  // Declared after the state its callbacks use.
+  auto ray_queries = ray_tracer::RayQueryService(render_pool);
+  const auto query_light_visibility = [&] {
+    if (light_query_pending.load(std::memory_order_acquire)) {
+      return;
+    }
+    const auto camera_position = fps_camera.GetPosition();
+    light_rays.count = std::min(light_positions.size(), kMaxQueriedLights);
+    for (size_t i = 0; i < light_rays.count; ++i) {
+      const auto& light_position = light_positions[i];
+      light_rays.origin_x[i] = camera_position.x;
+      light_rays.origin_y[i] = camera_position.y;
+      light_rays.origin_z[i] = camera_position.z;
+      light_rays.direction_x[i] = light_position.x - camera_position.x;
+      light_rays.direction_y[i] = light_position.y - camera_position.y;
+      light_rays.direction_z[i] = light_position.z - camera_position.z;
+      light_rays.min_distance[i] = 0.0f;
+      light_rays.max_distance[i] =
+          std::sqrt(light_rays.direction_x[i] * light_rays.direction_x[i] +
+                    light_rays.direction_y[i] * light_rays.direction_y[i] +
+                    light_rays.direction_z[i] * light_rays.direction_z[i]);
+    }
+    light_query_pending.store(true, std::memory_order_relaxed);
+    ray_queries.SubmitOcclusions(
+        geometry,
+        {.origin_x = std::span(light_rays.origin_x).first(light_rays.count),
+         .origin_y = std::span(light_rays.origin_y).first(light_rays.count),
+         .origin_z = std::span(light_rays.origin_z).first(light_rays.count),
+         .direction_x =
+             std::span(light_rays.direction_x).first(light_rays.count),
+         .direction_y =
+             std::span(light_rays.direction_y).first(light_rays.count),
+         .direction_z =
+             std::span(light_rays.direction_z).first(light_rays.count),
+         .min_distance =
+             std::span(light_rays.min_distance).first(light_rays.count),
+         .max_distance =
+             std::span(light_rays.max_distance).first(light_rays.count)},
+        light_rays.occluded, [&] {
+          queried_lights.store(light_rays.count, std::memory_order_relaxed);
+          occluded_lights.store(light_rays.occluded[0],
+                                std::memory_order_relaxed);
+          light_query_pending.store(false, std::memory_order_release);
+        });
+  };
+
+  // Input and simulation run on their own thread at a fixed rate; only window
+  // messages are handled on this one.
+  auto simulation_thread = std::jthread([&](std::stop_token stop_token) {
+    utils::trace::SetThreadName("simulation");
+    LONGLONG simulation_time = utils::win32::GetMilliseconds();
+    while (!stop_token.stop_requested()) {
+      const auto real_time = utils::win32::GetMilliseconds();
+
+      // Get keyboard input.
+      auto input_scope = std::optional<utils::trace::Scope>("poll input");
+      for (auto i = 0U; i < key_states.size(); ++i) {
+        key_states[i] = utils::win32::IsKeyPressed(static_cast<INT>(i));
+      }
+      if (key_states[VK_F1] && !prev_key_states[VK_F1]) {
+        shadow_visibility =
+            (shadow_visibility == ray_tracer::ShadowVisibility::Visible)
+                ? ray_tracer::ShadowVisibility::Hidden
+                : ray_tracer::ShadowVisibility::Visible;
+      }
+
+      if (key_states[VK_F2] && !prev_key_states[VK_F2]) {
+        reflection_visibility =
+            (reflection_visibility == ray_tracer::ReflectionVisibility::Visible)
+                ? ray_tracer::ReflectionVisibility::Hidden
+                : ray_tracer::ReflectionVisibility::Visible;
+      }
+
+      if (key_states[VK_F3] && !prev_key_states[VK_F3]) {
+        anti_aliasing = !anti_aliasing;
+      }
+
+      if (key_states[VK_F4] && !prev_key_states[VK_F4]) {
+        rasterized_visibility = !rasterized_visibility;
+      }
+
+      if (key_states[VK_F5] && !prev_key_states[VK_F5]) {
+        denoising = !denoising;
+      }
+
+      if (key_states[VK_F6] && !prev_key_states[VK_F6]) {
+        utils::trace::StartCapture(kTraceFrames);
+      }
+
+      if (key_states[VK_F7] && !prev_key_states[VK_F7]) {
+        ambient_occlusion = !ambient_occlusion;
+      }
+
+      if (key_states[VK_F8] && !prev_key_states[VK_F8]) {
+        path_tracing = !path_tracing;
+      }
+
+      if (key_states[VK_F9] && !prev_key_states[VK_F9]) {
+        view_layout = view_layout == ViewLayout::Single   ? ViewLayout::Stereo
+                      : view_layout == ViewLayout::Stereo ? ViewLayout::CubeMap
+                                                          : ViewLayout::Single;
+      }
+
+      // Update previous key states.
+      prev_key_states = key_states;
+      input_scope.reset();
+
+      // Update.
+      auto update_scope = std::optional<utils::trace::Scope>("simulate");
+      std::optional<SceneReload> reload{};
+      {
+        std::scoped_lock lock(scene_reload_mutex);
+        reload.swap(scene_reload);
+      }
+      if (reload.has_value()) {
+        apply_scene(*reload);
+      }
+      while (simulation_time < real_time) {
+        constexpr auto kSpeed = 1E-2f;
+        constexpr auto kRotationSpeed = 1E-1f;
+
+        float delta_move = kSpeed * kSimulationTimeStep;
+        float delta_rotate = kRotationSpeed * kSimulationTimeStep;
+
+        if (key_states['W']) {
+          fps_camera.Move(delta_move, 0.0F);  // Move forward.
+        } else if (key_states['S']) {
+          fps_camera.Move(-delta_move, 0.0F);  // Move backward.
+        } else if (key_states['A']) {
+          fps_camera.Move(0.0F, delta_move);  // Move left.
+        } else if (key_states['D']) {
+          fps_camera.Move(0.0F, -delta_move);  // Move right.
+        } else if (key_states[VK_DOWN]) {
+          fps_camera.Rotate(-delta_rotate, 0.0F);  // Look down.
+        } else if (key_states[VK_UP]) {
+          fps_camera.Rotate(delta_rotate, 0.0F);  // Look up.
+        } else if (key_states[VK_LEFT]) {
+          fps_camera.Rotate(0.0F, delta_rotate);  // Look left.
+        } else if (key_states[VK_RIGHT]) {
+          fps_camera.Rotate(0.0F, -delta_rotate);  // Look right.
+        }
+
+        // Paths accumulate over frames, so the scene holds still while path
+        // tracing.
+        if (!path_tracing) {
+          auto scope = utils::trace::Scope("animate scene");
+          live_scene.Animate();
+        }
+
+        simulation_time += kSimulationTimeStep;
+      }
+      update_scope.reset();
+
+      // Swap in levels of detail that finished streaming.
+      auto stream_scope = std::optional<utils::trace::Scope>("stream geometry");
+      geometry_streamer.Update(
+          utils::xm::float3a::Load(fps_camera.GetPosition()),
+          projection_scale);
+      live_scene.UpdateLevels();
+      stream_scope.reset();
+
+      {
+        auto scope = utils::trace::Scope("publish snapshot");
+        publish_snapshot();
+        query_light_visibility();
+      }
+
+      auto scope = utils::trace::Scope("limit frame rate");
+      utils::win32::LimitFrameRate(kFps, real_time);
+    }
+  });
+
   while (running) {
     const auto real_time = utils::win32::GetMilliseconds();
 
     // Check for window messages.
+    auto messages_scope =
+        std::optional<utils::trace::Scope>("window messages");
     MSG msg{};
     while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
       TranslateMessage(&msg);
@@ -158,91 +709,498 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev_instance,
       }
     }
 
-    // Get keyboard input.
-    for (auto i = 0U; i < key_states.size(); ++i) {
-      key_states[i] = utils::win32::IsKeyPressed(static_cast<INT>(i));
-    }
-    if (key_states[VK_F1] && !prev_key_states[VK_F1]) {
-      shadow_visibility =
-          (shadow_visibility == ray_tracer::ShadowVisibility::Visible)
-              ? ray_tracer::ShadowVisibility::Hidden
-              : ray_tracer::ShadowVisibility::Visible;
-    }
+    messages_scope.reset();
 
-    if (key_states[VK_F2] && !prev_key_states[VK_F2]) {
-      reflection_visibility =
-          (reflection_visibility == ray_tracer::ReflectionVisibility::Visible)
-              ? ray_tracer::ReflectionVisibility::Hidden
-              : ray_tracer::ReflectionVisibility::Visible;
-    }
+    // Render only when the simulation published something new; the snapshot
+    // stays untouched until the next `Acquire`.
+    if (snapshots.Acquire()) {
+      auto render_scope = utils::trace::Scope("render");
+      // Transient data of the last frame is no longer in use.
+      utils::memory::BeginFrame();
+      ambient_occlusion_cache.BeginFrame();
+      const auto render_start_time = std::chrono::steady_clock::now();
+      const uint64_t start_allocations = utils::memory::GetGlobalAllocations();
+      const auto& snapshot = snapshots.Front();
+      const auto camera_to_world_matrix =
+          DirectX::XMLoadFloat4x4A(&snapshot.camera_to_world_matrix);
 
-    // Update previous key states.
-    prev_key_states = key_states;
-
-    // Update.
-    while (simulation_time < real_time) {
-      constexpr auto kSpeed = 1E-2f;
-      constexpr auto kRotationSpeed = 1E-1f;
-
-      float delta_move = kSpeed * kSimulationTimeStep;
-      float delta_rotate = kRotationSpeed * kSimulationTimeStep;
-
-      if (key_states['W']) {
-        fps_camera.Move(delta_move, 0.0F);  // Move forward.
-      } else if (key_states['S']) {
-        fps_camera.Move(-delta_move, 0.0F);  // Move backward.
-      } else if (key_states['A']) {
-        fps_camera.Move(0.0F, delta_move);  // Move left.
-      } else if (key_states['D']) {
-        fps_camera.Move(0.0F, -delta_move);  // Move right.
-      } else if (key_states[VK_DOWN]) {
-        fps_camera.Rotate(-delta_rotate, 0.0F);  // Look down.
-      } else if (key_states[VK_UP]) {
-        fps_camera.Rotate(delta_rotate, 0.0F);  // Look up.
-      } else if (key_states[VK_LEFT]) {
-        fps_camera.Rotate(0.0F, delta_rotate);  // Look left.
-      } else if (key_states[VK_RIGHT]) {
-        fps_camera.Rotate(0.0F, -delta_rotate);  // Look right.
-      }
-
-      simulation_time += kSimulationTimeStep;
-    }
+      const bool multi_view = snapshot.view_layout != ViewLayout::Single;
+      const auto& quality_level = quality_controller.GetLevel();
+      auto& target =
+          get_render_target(multi_view || snapshot.path_tracing
+                                ? 1.0f
+                                : quality_level.resolution_scale);
+      const size_t target_pixels =
+          static_cast<size_t>(target.width) * target.height;
+      if (snapshot.anti_aliasing) {
+        target.sampler.SetMaxSamplesPerPixel(
+            quality_level.max_samples_per_pixel);
+        target.sampler.SetRayBudget(static_cast<size_t>(
+            static_cast<float>(target_pixels) * quality_level.rays_per_pixel));
+      } else {
+        target.sampler.SetMaxSamplesPerPixel(1);
+        target.sampler.SetRayBudget(target_pixels);
+      }
+      const auto shadow_rays = quality_level.secondary_depth >= 1
+                                   ? snapshot.shadow_visibility
+                                   : ray_tracer::ShadowVisibility::Hidden;
+      const auto reflection_rays =
+          quality_level.secondary_depth >= 2
+              ? snapshot.reflection_visibility
+              : ray_tracer::ReflectionVisibility::Hidden;
+
+      // Snapshots of steps that changed nothing share their geometry.
+      if (replicate_scene && replicated_geometry != snapshot.geometry) {
+        auto scope = utils::trace::Scope("replicate scene");
+        replicated_geometry = snapshot.geometry;
+        render_pool.ForEachNode([&](unsigned int node_index) {
+          auto& replica = scene_replicas[node_index];
+          const auto& meshes = snapshot.geometry->meshes;
+          replica.sources.resize(meshes.size());
+          replica.copies.resize(meshes.size());
+          replica.meshes.resize(meshes.size());
+          for (size_t i = 0; i < meshes.size(); ++i) {
+            if (replica.sources[i] != meshes[i]) {
+              replica.sources[i] = meshes[i];
+              if (replica.copies[i] == nullptr) {
+                replica.copies[i] = std::make_shared<scene::Mesh>();
+              }
+              *replica.copies[i] = *meshes[i];
+              replica.meshes[i] = replica.copies[i];
+            }
+          }
+        });
+      }
 
-    auto camera_to_world_matrix = fps_camera.GetCameraToWorldMatrix();
+      // Meshes in the memory of the node of the calling thread.
+      const auto get_node_meshes = [&]() -> std::span<const scene::SharedMesh> {
+        if (replicate_scene) {
+          return scene_replicas[utils::numa::ThreadPool::CurrentNode()].meshes;
+        }
+        return snapshot.geometry->meshes;
+      };
 
-    cube_3.Rotate(0.0f, 0.2f, 0.0f);
+      // Cull meshes and primitives against the frustum of each tile. Multi-view
+      // rendering culls against its own views instead.
+      if (!multi_view) {
+        auto scope = utils::trace::Scope("cull");
+        target.tile_grid.Cull(camera_to_world_matrix,
+                              snapshot.geometry->bounds);
+      }
 
-    // Render.
-    page ^= 1;
-    auto& current_view = page ? front_buffer : back_buffer;
-    auto& display_view = page ? back_buffer : front_buffer;
+      if (snapshot.rasterized_visibility && !multi_view) {
+        auto scope = utils::trace::Scope("rasterize");
+        target.rasterizer.Render(
+            snapshot.geometry->meshes,
+            DirectX::XMLoadFloat4x4A(&snapshot.world_to_camera_matrix),
+            target.tile_grid);
+      }
+
+      // Render.
+      page ^= 1;
+      auto& current_view = page ? front_buffer : back_buffer;
+
+      // Surface color before lighting, from the texture of the mesh or
+      // primitive if it has one, at the mip level of the ray cone of a pixel.
+      const auto& scene_geometry = *snapshot.geometry;
+      const std::span<const scene::Primitive> primitives =
+          scene_geometry.primitives;
+      const float spread_angle = ray_tracer::GetPixelSpreadAngle(
+          static_cast<int>(target.width), static_cast<int>(target.height));
+      // Path tracing waits for missing tiles, so that the accumulated image
+      // does not depend on which tiles were resident.
+      const auto get_albedo = [&](std::span<const scene::SharedMesh> meshes,
+                                  const ray_tracer::Hit& hit,
+                                  DirectX::FXMVECTOR direction,
+                                  DirectX::FXMVECTOR origin,
+                                  float spread_angle) {
+        const auto texture = hit.mesh_index < scene_geometry.textures.size()
+                                 ? scene_geometry.textures[hit.mesh_index]
+                                 : scene::SceneGeometry::kNoTexture;
+        if (texture == scene::SceneGeometry::kNoTexture) {
+          return ray_tracer::GetHitAlbedo(meshes, hit);
+        }
+        const auto& mesh_uvs = scene_geometry.mesh_uvs;
+        const auto uv = ray_tracer::GetHitUv(meshes, mesh_uvs, hit);
+        const float lod = ray_tracer::GetHitTextureLod(
+            meshes, primitives, mesh_uvs, hit, direction, origin, spread_angle,
+            texture_cache.GetSize(texture));
+        return snapshot.path_tracing
+                   ? texture_cache.SampleExact(texture, uv, lod)
+                   : texture_cache.Sample(texture, uv, lod);
+      };
+      // Occlusion of the side facing the camera; a cell spans a few pixels
+      // wherever it is.
+      const auto get_ambient_visibility =
+          [&](std::span<const scene::SharedMesh> meshes,
+              const ray_tracer::Hit& hit,
+              DirectX::FXMVECTOR direction, DirectX::FXMVECTOR origin,
+              float spread_angle) {
+            if (!snapshot.ambient_occlusion) {
+              return 1.0f;
+            }
+            auto normal = ray_tracer::GetHitNormal(meshes, primitives, hit,
+                                                   direction, origin);
+            if (DirectX::XMVectorGetX(
+                    DirectX::XMVector3Dot(normal, direction)) > 0.0f) {
+              normal = DirectX::XMVectorNegate(normal);
+            }
+            return ambient_occlusion_cache.GetVisibility(
+                meshes, primitives,
+                utils::xm::ray::At(origin, direction, hit.distance), normal,
+                spread_angle * hit.distance);
+          };
 
-    std::span<DirectX::XMUINT2> pixel_span(pixels);
+      auto sample_scope = std::optional<utils::trace::Scope>("trace rays");
+      if (multi_view) {
+        path_camera.reset();
+        const bool stereo = snapshot.view_layout == ViewLayout::Stereo;
+        auto& renderer = stereo ? stereo_renderer : cube_map_renderer;
+        if (stereo) {
+          renderer.SetViews(ray_tracer::MakeStereoViews(
+              camera_to_world_matrix, kEyeSeparation, kWidth / 2, kHeight));
+        } else {
+          renderer.SetViews(ray_tracer::MakeCubeMapViews(
+              DirectX::XMVector3Transform(DirectX::g_XMZero,
+                                          camera_to_world_matrix),
+              kCubeMapSize));
+        }
+        // All views of a layout have the same size.
+        const auto& first_view = renderer.Views().front();
+        const float view_spread_angle = ray_tracer::GetPixelSpreadAngle(
+            static_cast<int>(first_view.width),
+            static_cast<int>(first_view.height));
+        renderer.Render(
+            scene_geometry.bounds,
+            [&](size_t, unsigned int, unsigned int,
+                DirectX::FXMVECTOR direction, DirectX::FXMVECTOR origin,
+                std::span<const uint32_t> mesh_indices) {
+              const auto meshes = get_node_meshes();
+              const auto hit = ray_tracer::FindClosestHit(
+                  meshes, primitives, mesh_indices, direction, origin);
+              return hit.has_value()
+                         ? ray_tracer::ShadeHit(
+                               shadow_rays, reflection_rays, meshes,
+                               primitives, *hit, direction, origin,
+                               get_albedo(meshes, *hit, direction, origin,
+                                          view_spread_angle),
+                               get_ambient_visibility(meshes, *hit, direction,
+                                                      origin,
+                                                      view_spread_angle),
+                               snapshot.light_positions)
+                         : DirectX::g_XMOne;
+            });
 
-    std::for_each(
-        std::execution::par, pixels.begin(), pixels.end(), [&](auto& p) {
-          const auto x = p.x;
-          const auto y = p.y;
+        auto mosaic =
+            MatrixView<DirectX::XMFLOAT3A>(view_mosaic, kHeight, kWidth);
+        mosaic.Clear();
+        for (size_t view_index = 0; view_index < renderer.Views().size();
+             ++view_index) {
+          const auto colors = renderer.Colors(view_index);
+          const size_t row = stereo ? 0 : view_index / 3 * kCubeMapSize;
+          const size_t column = stereo ? view_index * (kWidth / 2)
+                                       : view_index % 3 * kCubeMapSize;
+          auto region = mosaic.Submatrix(row, column, colors.Rows(),
+                                         colors.Columns());
+          for (size_t y = 0; y < colors.Rows(); ++y) {
+            for (size_t x = 0; x < colors.Columns(); ++x) {
+              region.At(y, x) = colors.At(y, x);
+            }
+          }
+        }
+      } else if (snapshot.path_tracing) {
+        // Start over when the camera moved, the scene was reloaded, a
+        // streamed level changed what rays see, or path tracing was switched
+        // on. Texture tiles coming and going do not matter, since paths wait
+        // for the ones they sample.
+        if (!path_camera.has_value() ||
+            std::memcmp(&*path_camera, &snapshot.camera_to_world_matrix,
+                        sizeof(DirectX::XMFLOAT4X4A)) != 0 ||
+            path_scene_version != snapshot.scene_version ||
+            path_level_version != snapshot.level_version) {
+          path_tracer.Reset();
+          path_camera = snapshot.camera_to_world_matrix;
+          path_scene_version = snapshot.scene_version;
+          path_level_version = snapshot.level_version;
+        }
+        path_tracer.Render([&](unsigned int x, unsigned int y, float offset_x,
+                               float offset_y,
+                               ray_tracer::PathRandom& random,
+                               uint64_t& rays) {
+          const auto meshes = get_node_meshes();
 
           DirectX::XMVECTOR origin = {};
           DirectX::XMVECTOR direction = {};
-          CreateCameraRay(origin, direction, x, y, kWidth, kHeight,
-                          camera_to_world_matrix);
+          ray_tracer::CreateCameraRay(origin, direction, x, y, kWidth, kHeight,
+                                      camera_to_world_matrix, offset_x,
+                                      offset_y);
+          return ray_tracer::TracePath(
+              meshes, primitives, snapshot.light_positions,
+              [&](const ray_tracer::Hit& hit, DirectX::FXMVECTOR ray_direction,
+                  DirectX::FXMVECTOR ray_origin, unsigned int bounce) {
+                return get_albedo(
+                    meshes, hit, ray_direction, ray_origin,
+                    bounce == 0 ? path_spread_angle : kBounceSpreadAngle);
+              },
+              path_tracer.GetSettings(), direction, origin, random, rays);
+        });
+      } else {
+        path_camera.reset();
+        target.sampler.Render([&](unsigned int x, unsigned int y,
+                                  float offset_x, float offset_y,
+                                  bool guides) {
+          const auto meshes = get_node_meshes();
 
-          auto color =
-              ray_tracer::TraceRays(shadow_visibility, reflection_visibility,
-                                    meshes, direction, origin, light_positions);
+          DirectX::XMVECTOR origin = {};
+          DirectX::XMVECTOR direction = {};
+          ray_tracer::CreateCameraRay(
+              origin, direction, x, y, static_cast<int>(target.width),
+              static_cast<int>(target.height), camera_to_world_matrix, offset_x,
+              offset_y);
 
-          color = DirectX::XMVectorMultiply(color,
-                                            DirectX::XMVectorReplicate(255.0f));
+          // The visibility buffer holds the hits of rays through pixel centers
+          // on the meshes, the samples called with `guides`; primitives are
+          // not rasterized, so they are traced.
+          const auto mesh_indices = target.tile_grid.At(x, y).mesh_indices;
+          std::optional<ray_tracer::Hit> hit{};
+          if (snapshot.rasterized_visibility && guides) {
+            hit = target.rasterizer.At(x, y);
+            ray_tracer::FindCloserPrimitiveHit(hit, meshes.size(), primitives,
+                                               mesh_indices, direction, origin);
+          } else {
+            hit = ray_tracer::FindClosestHit(meshes, primitives, mesh_indices,
+                                             direction, origin);
+          }
+          const auto albedo =
+              hit.has_value()
+                  ? get_albedo(meshes, *hit, direction, origin, spread_angle)
+                  : DirectX::g_XMZero;
+          const float ambient_visibility =
+              hit.has_value() ? get_ambient_visibility(meshes, *hit, direction,
+                                                       origin, spread_angle)
+                              : 1.0f;
+          const auto color =
+              hit.has_value()
+                  ? ray_tracer::ShadeHit(shadow_rays, reflection_rays, meshes,
+                                         primitives, *hit, direction, origin,
+                                         albedo, ambient_visibility,
+                                         snapshot.light_positions)
+                  : DirectX::g_XMOne;
 
-          current_view.At(y, x) = utils::win32::CreateHighColor(
-              static_cast<uint8_t>(DirectX::XMVectorGetX(color)),
-              static_cast<uint8_t>(DirectX::XMVectorGetY(color)),
-              static_cast<uint8_t>(DirectX::XMVectorGetZ(color)));
+          return ray_tracer::MakeSample(meshes, primitives, color, albedo,
+                                        direction, origin, hit, guides);
         });
+      }
+
+      sample_scope.reset();
+
+      if (snapshot.denoising && !snapshot.path_tracing && !multi_view) {
+        auto scope = utils::trace::Scope("denoise");
+        target.denoiser.Denoise(target.sampler.Colors(),
+                                target.sampler.Samples());
+      }
+
+      // Upscale to the output resolution.
+      const auto colors =
+          multi_view ? MatrixView<DirectX::XMFLOAT3A>(view_mosaic, kHeight,
+                                                      kWidth)
+          : snapshot.path_tracing ? path_tracer.Colors()
+          : snapshot.denoising    ? target.denoiser.Colors()
+                                  : target.sampler.Colors();
+      const bool upscale = target.width != kWidth || target.height != kHeight;
+      const float scale_x = static_cast<float>(target.width) / kWidth;
+      const float scale_y = static_cast<float>(target.height) / kHeight;
+      auto upscale_scope = std::optional<utils::trace::Scope>("upscale");
+      render_pool.ParallelFor(
+          frame_tile_rows * frame_tile_columns, frame_tile_columns,
+          [&](size_t begin, size_t end) {
+            for (size_t tile = begin; tile < end; ++tile) {
+              const size_t first_y =
+                  (tile / frame_tile_columns) * frame_tile_size;
+              const size_t first_x =
+                  (tile % frame_tile_columns) * frame_tile_size;
+              const size_t last_y =
+                  std::min(first_y + frame_tile_size, size_t{kHeight});
+              const size_t last_x =
+                  std::min(first_x + frame_tile_size, size_t{kWidth});
+              for (size_t y = first_y; y < last_y; ++y) {
+                for (size_t x = first_x; x < last_x; ++x) {
+                  auto color = DirectX::XMVectorMultiply(
+                      upscale ? ray_tracer::SampleBilinear(
+                                    colors,
+                                    (static_cast<float>(x) + 0.5f) * scale_x,
+                                    (static_cast<float>(y) + 0.5f) * scale_y)
+                              : DirectX::XMLoadFloat3A(&colors.At(y, x)),
+                      DirectX::XMVectorReplicate(255.0f));
+
+                  frame_tiles.At(y, x) = utils::win32::CreateHighColor(
+                      static_cast<uint8_t>(DirectX::XMVectorGetX(color)),
+                      static_cast<uint8_t>(DirectX::XMVectorGetY(color)),
+                      static_cast<uint8_t>(DirectX::XMVectorGetZ(color)));
+                }
+              }
+            }
+          });
+
+      upscale_scope.reset();
+
+      {
+        auto scope = utils::trace::Scope("linearize");
+        render_pool.ParallelFor(
+            frame_tile_rows, 1, [&](size_t begin, size_t end) {
+              frame_tiles.Linearize(
+                  current_view, begin * frame_tile_size,
+                  std::min(end * frame_tile_size, size_t{kHeight}));
+            });
+      }
+
+      // Path tracing and multi-view frames take as long as they take; they do
+      // not steer the quality of the real-time renderer.
+      if (!snapshot.path_tracing && !multi_view) {
+        quality_controller.Update(std::chrono::duration<float, std::milli>(
+                                      std::chrono::steady_clock::now() -
+                                      render_start_time)
+                                      .count());
+      }
+      peak_frame_allocations =
+          std::max(peak_frame_allocations,
+                   utils::memory::GetGlobalAllocations() - start_allocations);
+    }
+
+    // Textures of replaced materials are unused once the rendered snapshot
+    // comes from the load that replaced them.
+    std::erase_if(retired_textures, [&](const RetiredTexture& retired) {
+      if (retired.version > snapshots.Front().scene_version) {
+        return false;
+      }
+      texture_cache.RemoveTexture(retired.texture);
+      std::error_code error{};
+      std::filesystem::remove(texture_paths[retired.texture], error);
+      return true;
+    });
+
+    // Reload the scene between frames when its file changed.
+    if (real_time - scene_poll_time >= kScenePollInterval) {
+      scene_poll_time = real_time;
+      if (scene_watcher.Poll()) {
+        if (auto reload = load_scene()) {
+          std::scoped_lock lock(scene_reload_mutex);
+          scene_reload = std::move(*reload);
+        }
+      }
+    }
+
+    if (real_time - stats_time >= kStatsInterval) {
+      const double seconds =
+          static_cast<double>(real_time - stats_time) / 1000.0;
+      std::wstring title = L"App";
+      const auto node_stats = render_pool.GetStats();
+      for (size_t node_index = 0; node_index < node_stats.size();
+           ++node_index) {
+        const auto& stats = node_stats[node_index];
+        title += L" | node " +
+                 std::to_wstring(render_pool.Nodes()[node_index].number) +
+                 L": " +
+                 std::to_wstring(static_cast<size_t>(
+                     static_cast<double>(stats.items) / seconds / 1000.0)) +
+                 L"k items/s, " + std::to_wstring(stats.stolen_items) +
+                 L" stolen";
+      }
+      const auto lights = queried_lights.load(std::memory_order_relaxed);
+      const auto occluded = std::min(
+          lights, static_cast<size_t>(std::popcount(
+                      occluded_lights.load(std::memory_order_relaxed))));
+      const auto& quality_level = quality_controller.GetLevel();
+      const auto& quality_stats = quality_controller.GetStats();
+      const auto& target = get_render_target(quality_level.resolution_scale);
+      title += L" | " + std::to_wstring(target.width) + L"x" +
+               std::to_wstring(target.height) + L", " +
+               std::to_wstring(quality_level.max_samples_per_pixel) +
+               L" spp, depth " +
+               std::to_wstring(quality_level.secondary_depth) + L", " +
+               std::to_wstring(static_cast<int>(
+                   std::lround(quality_stats.average_frame_time))) +
+               L" ms, -" + std::to_wstring(quality_stats.downgrades) + L"/+" +
+               std::to_wstring(quality_stats.upgrades) + L" | lights in view " +
+               std::to_wstring(lights - occluded) + L"/" +
+               std::to_wstring(lights);
+      const auto arena_stats = utils::memory::GetFrameArenaStats();
+      title += L" | arenas " +
+               std::to_wstring(arena_stats.high_water_bytes / 1024) +
+               L" KiB peak, " + std::to_wstring(arena_stats.heap_allocations) +
+               L" heap allocations | " +
+               std::to_wstring(peak_frame_allocations) +
+               L" global allocations per frame at most";
+      peak_frame_allocations = 0;
+      const auto texture_stats = texture_cache.GetStats();
+      title += L" | texture tiles " +
+               std::to_wstring(texture_stats.resident_tiles) + L"/" +
+               std::to_wstring(texture_stats.capacity_tiles) + L", " +
+               std::to_wstring(texture_stats.hits * 100 /
+                               std::max(texture_stats.hits +
+                                            texture_stats.misses,
+                                        size_t{1})) +
+               L"% hits";
+      const auto ambient_occlusion_stats = ambient_occlusion_cache.GetStats();
+      title += L" | AO cells " +
+               std::to_wstring(ambient_occlusion_stats.cells) + L"/" +
+               std::to_wstring(ambient_occlusion_stats.capacity_cells) + L", " +
+               std::to_wstring(ambient_occlusion_stats.hits * 100 /
+                               std::max(ambient_occlusion_stats.hits +
+                                            ambient_occlusion_stats.misses,
+                                        size_t{1})) +
+               L"% hits";
+      const auto path_tracer_stats = path_tracer.GetStats();
+      if (path_tracer_stats.seconds > 0.0) {
+        title +=
+            L" | path tracing " +
+            std::to_wstring(path_tracer_stats.samples_per_pixel) + L" spp, " +
+            std::to_wstring(static_cast<size_t>(
+                static_cast<double>(path_tracer_stats.paths) /
+                path_tracer_stats.seconds / 1000.0)) +
+            L"k samples/s, " +
+            std::to_wstring(static_cast<size_t>(
+                static_cast<double>(path_tracer_stats.rays) /
+                path_tracer_stats.seconds / 1.0e6)) +
+            L"M rays/s";
+      }
+      for (const auto* renderer : {&stereo_renderer, &cube_map_renderer}) {
+        const auto multi_view_stats = renderer->GetStats();
+        if (multi_view_stats.seconds > 0.0) {
+          title += L" | " + std::to_wstring(renderer->Views().size()) +
+                   L" views, " +
+                   std::to_wstring(static_cast<size_t>(
+                       static_cast<double>(multi_view_stats.views) /
+                       multi_view_stats.seconds)) +
+                   L" views/s, " +
+                   std::to_wstring(static_cast<size_t>(
+                       static_cast<double>(multi_view_stats.pixels) /
+                       multi_view_stats.seconds / 1.0e6)) +
+                   L"M rays/s";
+        }
+      }
+      if (scene_error.empty()) {
+        const auto& scene_stats = snapshots.Front().scene_stats;
+        title += L" | scene: " + std::to_wstring(scene_stats.built_instances) +
+                 L" built, " + std::to_wstring(scene_stats.kept_instances) +
+                 L" kept, " + std::to_wstring(scene_stats.failed_instances) +
+                 L" failed";
+      } else {
+        title += L" | scene: " +
+                 std::wstring(scene_error.begin(), scene_error.end());
+      }
+      SetWindowText(window, title.c_str());
+      render_pool.ResetStats();
+      ambient_occlusion_cache.ResetStats();
+      path_tracer.ResetStats();
+      stereo_renderer.ResetStats();
+      cube_map_renderer.ResetStats();
+      stats_time = real_time;
+    }
 
     // Render to window.
+    auto present_scope = std::optional<utils::trace::Scope>("present");
+    auto& display_view = page ? back_buffer : front_buffer;
     HDC device_context = GetDC(window);
     StretchDIBits(device_context, 0, 0, kDoubleWidth, kDoubleHeight, 0, 0,
                   static_cast<INT>(display_view.Columns()),
@@ -250,8 +1208,16 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev_instance,
                   display_view.Elements().data(), &bmi, DIB_RGB_COLORS,
                   SRCCOPY);
     ReleaseDC(window, device_context);
+    present_scope.reset();
+
+    {
+      auto scope = utils::trace::Scope("limit frame rate");
+      utils::win32::LimitFrameRate(kFps, real_time);
+    }
 
-    utils::win32::LimitFrameRate(kFps, real_time);
+    if (utils::trace::EndFrame()) {
+      utils::trace::WriteJson(trace_path);
+    }
   }
 
   return 0;
@@ -9,6 +9,14 @@ class FpsCamera {
  public:
   inline FpsCamera() : position_(0.0f, 0.0f, 0.0f), pitch_(0.0f), yaw_(0.0f) {}
 
+  // Angles in degrees.
+  inline FpsCamera(const DirectX::XMFLOAT3& position, float pitch, float yaw)
+      : position_(position.x, position.y, position.z),
+        pitch_(0.0f),
+        yaw_(0.0f) {
+    Rotate(pitch, yaw);
+  }
+
   inline void Move(float delta_forward, float delta_right) {
     DirectX::XMFLOAT3A move_direction{};
     DirectX::XMStoreFloat3A(
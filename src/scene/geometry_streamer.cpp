@@ -0,0 +1,262 @@
+#include "geometry_streamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../utils/trace.h"
+#include "mesh_lod.h"
+
+namespace {
+// Cameras inside a bounding sphere see the mesh at full detail.
+constexpr auto kMinDistance = 1.0e-3f;
+}  // namespace
+
+scene::GeometryStreamer::GeometryStreamer(size_t memory_budget,
+                                          unsigned int io_thread_count)
+    : memory_budget_(memory_budget) {
+  for (auto i = 0U; i < io_thread_count; ++i) {
+    io_threads_.emplace_back(
+        [this](std::stop_token stop_token) { RunIoThread(stop_token); });
+  }
+}
+
+std::optional<size_t> scene::GeometryStreamer::AddMesh(
+    const std::filesystem::path& directory, std::string_view name,
+    const DirectX::BoundingBox& bounds) {
+  StreamedMesh streamed_mesh{};
+  streamed_mesh.removed = false;
+  DirectX::BoundingSphere::CreateFromBoundingBox(streamed_mesh.bounds, bounds);
+
+  for (size_t level = 0;; ++level) {
+    auto path = GetLodPath(directory, name, level);
+    std::error_code error{};
+    const auto bytes = std::filesystem::file_size(path, error);
+    if (error) {
+      break;
+    }
+    streamed_mesh.levels.push_back({.path = std::move(path),
+                                    .bytes = static_cast<size_t>(bytes),
+                                    .state = LevelState::kEvicted,
+                                    .last_used_frame = 0,
+                                    .mesh = nullptr,
+                                    .uvs = nullptr});
+  }
+  if (streamed_mesh.levels.empty()) {
+    return std::nullopt;
+  }
+
+  // The coarsest level is the fallback while finer ones stream in.
+  auto& coarsest = streamed_mesh.levels.back();
+  MeshUvs uvs{};
+  auto mesh = LoadMesh(coarsest.path, uvs);
+  if (!mesh.has_value()) {
+    return std::nullopt;
+  }
+  coarsest.mesh = std::make_shared<const Mesh>(std::move(*mesh));
+  coarsest.uvs = std::make_shared<const MeshUvs>(std::move(uvs));
+  coarsest.state = LevelState::kResident;
+  streamed_mesh.selected_level = streamed_mesh.levels.size() - 1;
+
+  std::scoped_lock lock(mutex_);
+  stats_.resident_bytes += coarsest.bytes;
+  // Reuse the handle of a removed mesh once none of its loads is in flight.
+  const auto reused = std::ranges::find_if(meshes_, [](const auto& other) {
+    return other.removed &&
+           std::ranges::none_of(other.levels, [](const Level& level) {
+             return level.state == LevelState::kQueued;
+           });
+  });
+  if (reused != meshes_.end()) {
+    *reused = std::move(streamed_mesh);
+    return static_cast<size_t>(reused - meshes_.begin());
+  }
+  meshes_.push_back(std::move(streamed_mesh));
+  return meshes_.size() - 1;
+}
+
+void scene::GeometryStreamer::RemoveMesh(size_t handle) {
+  std::scoped_lock lock(mutex_);
+  auto& mesh = meshes_[handle];
+  mesh.removed = true;
+  // Levels an I/O thread is reading are dropped when their load completes.
+  std::erase_if(requests_, [&](const LoadRequest& request) {
+    if (request.handle != handle) {
+      return false;
+    }
+    auto& level = mesh.levels[request.level];
+    stats_.pending_bytes -= level.bytes;
+    --stats_.pending_loads;
+    level.state = LevelState::kEvicted;
+    return true;
+  });
+  for (auto& level : mesh.levels) {
+    if (level.state == LevelState::kResident) {
+      stats_.resident_bytes -= level.bytes;
+    }
+    if (level.state != LevelState::kQueued) {
+      level.state = LevelState::kEvicted;
+    }
+    level.mesh.reset();
+    level.uvs.reset();
+  }
+}
+
+void scene::GeometryStreamer::Update(DirectX::FXMVECTOR camera_position,
+                                     float projection_scale) {
+  std::scoped_lock lock(mutex_);
+  ++frame_;
+
+  size_t needed_bytes = 0;
+  std::vector<LoadRequest> new_requests{};
+  for (size_t handle = 0; handle < meshes_.size(); ++handle) {
+    auto& mesh = meshes_[handle];
+    if (mesh.removed) {
+      continue;
+    }
+    // Distance to the closest point of the bounding sphere.
+    const float center_distance = DirectX::XMVectorGetX(
+        DirectX::XMVector3Length(DirectX::XMVectorSubtract(
+            DirectX::XMLoadFloat3(&mesh.bounds.Center), camera_position)));
+    const float distance =
+        std::fmaxf(center_distance - mesh.bounds.Radius, kMinDistance);
+    const float projected_pixels =
+        2.0f * mesh.bounds.Radius * projection_scale / distance;
+
+    const float halvings =
+        std::log2(std::fmaxf(kFullDetailPixels / projected_pixels, 1.0f));
+    mesh.selected_level = std::min(static_cast<size_t>(halvings),
+                                   mesh.levels.size() - 1);
+
+    auto& level = mesh.levels[mesh.selected_level];
+    level.last_used_frame = frame_;
+    if (level.state == LevelState::kEvicted) {
+      new_requests.push_back({handle, mesh.selected_level});
+      needed_bytes += level.bytes;
+    }
+  }
+
+  EvictUnusedLevels(needed_bytes);
+
+  // Queue what fits into the budget; the rest is retried next frame.
+  for (const auto& request : new_requests) {
+    auto& level = meshes_[request.handle].levels[request.level];
+    if (stats_.resident_bytes + stats_.pending_bytes + level.bytes >
+        memory_budget_) {
+      continue;
+    }
+    level.state = LevelState::kQueued;
+    stats_.pending_bytes += level.bytes;
+    ++stats_.pending_loads;
+    requests_.push_back(request);
+  }
+  requests_available_.notify_all();
+}
+
+void scene::GeometryStreamer::EvictUnusedLevels(size_t needed_bytes) {
+  while (stats_.resident_bytes + stats_.pending_bytes + needed_bytes >
+         memory_budget_) {
+    // Least recently used resident level, except the coarsest fallbacks and
+    // anything selected this frame.
+    Level* victim = nullptr;
+    for (auto& mesh : meshes_) {
+      for (size_t i = 0; i + 1 < mesh.levels.size(); ++i) {
+        auto& level = mesh.levels[i];
+        if (level.state == LevelState::kResident &&
+            level.last_used_frame < frame_ &&
+            (victim == nullptr ||
+             level.last_used_frame < victim->last_used_frame)) {
+          victim = &level;
+        }
+      }
+    }
+    if (victim == nullptr) {
+      return;
+    }
+
+    victim->mesh.reset();
+    victim->uvs.reset();
+    victim->state = LevelState::kEvicted;
+    stats_.resident_bytes -= victim->bytes;
+    ++stats_.evictions;
+  }
+}
+
+std::shared_ptr<const scene::Mesh> scene::GeometryStreamer::GetMesh(
+    size_t handle, size_t& out_level) const {
+  std::shared_ptr<const MeshUvs> uvs{};
+  return GetMesh(handle, out_level, uvs);
+}
+
+std::shared_ptr<const scene::Mesh> scene::GeometryStreamer::GetMesh(
+    size_t handle, size_t& out_level,
+    std::shared_ptr<const MeshUvs>& out_uvs) const {
+  std::scoped_lock lock(mutex_);
+  const auto& mesh = meshes_[handle];
+
+  // Prefer the selected level, then finer levels, then coarser ones.
+  const auto is_resident = [&](size_t level) {
+    return mesh.levels[level].state == LevelState::kResident;
+  };
+  out_level = mesh.selected_level;
+  for (size_t distance = 0; distance < mesh.levels.size(); ++distance) {
+    if (distance <= mesh.selected_level &&
+        is_resident(mesh.selected_level - distance)) {
+      out_level = mesh.selected_level - distance;
+      break;
+    }
+    if (mesh.selected_level + distance < mesh.levels.size() &&
+        is_resident(mesh.selected_level + distance)) {
+      out_level = mesh.selected_level + distance;
+      break;
+    }
+  }
+  out_uvs = mesh.levels[out_level].uvs;
+  return mesh.levels[out_level].mesh;
+}
+
+scene::GeometryStreamerStats scene::GeometryStreamer::GetStats() const {
+  std::scoped_lock lock(mutex_);
+  return stats_;
+}
+
+void scene::GeometryStreamer::RunIoThread(std::stop_token stop_token) {
+  utils::trace::SetThreadName("geometry io");
+  while (true) {
+    LoadRequest request{};
+    std::filesystem::path path{};
+    {
+      std::unique_lock lock(mutex_);
+      if (!requests_available_.wait(lock, stop_token,
+                                    [this] { return !requests_.empty(); })) {
+        return;
+      }
+      request = requests_.front();
+      requests_.pop_front();
+      path = meshes_[request.handle].levels[request.level].path;
+    }
+
+    // Read without holding the lock.
+    MeshUvs uvs{};
+    auto mesh = [&] {
+      auto scope = utils::trace::Scope("load mesh");
+      return LoadMesh(path, uvs);
+    }();
+
+    std::scoped_lock lock(mutex_);
+    const bool removed = meshes_[request.handle].removed;
+    auto& level = meshes_[request.handle].levels[request.level];
+    stats_.pending_bytes -= level.bytes;
+    --stats_.pending_loads;
+    if (removed) {
+      level.state = LevelState::kEvicted;
+    } else if (mesh.has_value()) {
+      level.mesh = std::make_shared<const Mesh>(std::move(*mesh));
+      level.uvs = std::make_shared<const MeshUvs>(std::move(uvs));
+      level.state = LevelState::kResident;
+      stats_.resident_bytes += level.bytes;
+      ++stats_.completed_loads;
+    } else {
+      level.state = LevelState::kFailed;
+    }
+  }
+}
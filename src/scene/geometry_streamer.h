@@ -0,0 +1,108 @@
+#pragma once
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "mesh.h"
+
+namespace scene {
+struct GeometryStreamerStats {
+  size_t resident_bytes;
+  size_t pending_bytes;
+  size_t pending_loads;
+  size_t completed_loads;
+  size_t evictions;
+};
+
+// Keeps the levels of detail written by `WriteLods` on disk and streams in the
+// level that matches the projected size of each mesh. Loads run on background
+// I/O threads under a memory budget; the coarsest level of every mesh stays
+// resident, so there is always something to render.
+class GeometryStreamer {
+ public:
+  GeometryStreamer(size_t memory_budget, unsigned int io_thread_count);
+
+  GeometryStreamer(const GeometryStreamer&) = delete;
+  GeometryStreamer& operator=(const GeometryStreamer&) = delete;
+
+  // Register the levels of the mesh `name` in `directory`; `bounds` are the
+  // world space bounds of the mesh. Loads the coarsest level synchronously.
+  // Returns the handle of the mesh.
+  std::optional<size_t> AddMesh(const std::filesystem::path& directory,
+                                std::string_view name,
+                                const DirectX::BoundingBox& bounds);
+
+  // Drop the levels of a mesh that is no longer rendered. Its handle must not
+  // be used anymore; `AddMesh` may hand it out again.
+  void RemoveMesh(size_t handle);
+
+  // Select a level for every mesh from its projected size in pixels, where
+  // `projection_scale` is the number of pixels per unit at distance 1. Queues
+  // loads of missing levels and evicts unused ones when over budget.
+  void Update(DirectX::FXMVECTOR camera_position, float projection_scale);
+
+  // Finest resident level closest to the selected one, never null.
+  std::shared_ptr<const Mesh> GetMesh(size_t handle, size_t& out_level) const;
+
+  // Also return the texture coordinates of that level, empty if it has none.
+  std::shared_ptr<const Mesh> GetMesh(
+      size_t handle, size_t& out_level,
+      std::shared_ptr<const MeshUvs>& out_uvs) const;
+
+  GeometryStreamerStats GetStats() const;
+
+ private:
+  enum class LevelState { kEvicted, kQueued, kResident, kFailed };
+
+  struct Level {
+    std::filesystem::path path;
+    size_t bytes;
+    LevelState state;
+    uint64_t last_used_frame;
+    std::shared_ptr<const Mesh> mesh;
+    std::shared_ptr<const MeshUvs> uvs;
+  };
+
+  struct StreamedMesh {
+    DirectX::BoundingSphere bounds;
+    std::vector<Level> levels;
+    size_t selected_level;
+    bool removed;
+  };
+
+  struct LoadRequest {
+    size_t handle;
+    size_t level;
+  };
+
+  void RunIoThread(std::stop_token stop_token);
+
+  void EvictUnusedLevels(size_t needed_bytes);
+
+  // Pixels covered by the bounding sphere diameter at which level 0 is used;
+  // every further level halves it.
+  static constexpr float kFullDetailPixels = 256.0f;
+
+  size_t memory_budget_;
+  uint64_t frame_ = 0;
+  mutable std::mutex mutex_;
+  std::condition_variable_any requests_available_;
+  std::deque<LoadRequest> requests_;
+  std::vector<StreamedMesh> meshes_;
+  GeometryStreamerStats stats_{};
+  // Declared last, so the threads stop before the state they use goes away.
+  std::vector<std::jthread> io_threads_;
+};
+}  // namespace scene
@@ -0,0 +1,250 @@
+#include "live_scene.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <execution>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "../utils/trace.h"
+#include "mesh_lod.h"
+#include "mesh_view.h"
+#include "scene_geometry.h"
+
+namespace {
+// Vertices and texture coordinates of a built-in shape or a mesh file.
+struct MeshSource {
+  scene::Mesh mesh;
+  scene::MeshUvs uvs;
+  bool loaded;
+};
+
+MeshSource LoadMeshSource(const std::string& source) {
+  if (source == "cube") {
+    return {.mesh = scene::LoadCube(), .uvs = {}, .loaded = true};
+  }
+  if (source == "octahedron") {
+    return {.mesh = scene::LoadOctahedron(), .uvs = {}, .loaded = true};
+  }
+  if (source == "rectangle") {
+    return {.mesh = scene::LoadRectangle(),
+            .uvs = scene::LoadRectangleUvs(1.0f),
+            .loaded = true};
+  }
+  MeshSource mesh_source{.mesh = {}, .uvs = {}, .loaded = false};
+  if (auto mesh = scene::LoadMesh(source, mesh_source.uvs)) {
+    mesh_source.mesh = std::move(*mesh);
+    mesh_source.loaded = true;
+  }
+  return mesh_source;
+}
+
+void ApplyTransforms(scene::Mesh& mesh,
+                     std::span<const scene::TransformStep> transforms) {
+  auto view = scene::MeshView(mesh.first, mesh.second);
+  for (const auto& step : transforms) {
+    const auto& values = step.values;
+    switch (step.type) {
+      case scene::TransformType::kTranslate:
+        view.Translate(values.x, values.y, values.z);
+        break;
+      case scene::TransformType::kRotate:
+        view.Rotate(values.x, values.y, values.z);
+        break;
+      case scene::TransformType::kScale:
+        view.Scale(values.x, values.y, values.z);
+        break;
+    }
+  }
+}
+
+const std::string& GetMeshSource(const scene::SceneDescription& description,
+                                 const scene::InstanceDescription& instance) {
+  const auto mesh = std::ranges::find(description.meshes, instance.mesh,
+                                      &scene::MeshDescription::name);
+  assert(mesh != description.meshes.end());
+  return mesh->source;
+}
+
+uint32_t GetTexture(const scene::SceneDescription& description,
+                    std::span<const uint32_t> material_textures,
+                    std::string_view material) {
+  const auto found = std::ranges::find(description.materials, material,
+                                       &scene::MaterialDescription::name);
+  const auto index =
+      static_cast<size_t>(found - description.materials.begin());
+  return index < material_textures.size()
+             ? material_textures[index]
+             : scene::SceneGeometry::kNoTexture;
+}
+}  // namespace
+
+scene::LiveScene::LiveScene(GeometryStreamer& geometry_streamer,
+                            std::filesystem::path lod_directory,
+                            size_t lod_levels)
+    : geometry_streamer_(geometry_streamer),
+      lod_directory_(std::move(lod_directory)),
+      lod_levels_(lod_levels) {}
+
+void scene::LiveScene::Apply(const SceneDescription& description,
+                             const SceneDiff& diff,
+                             std::span<const uint32_t> material_textures) {
+  ++generation_;
+  ++version_;
+  stats_ = {.built_instances = 0, .kept_instances = 0, .failed_instances = 0};
+  const size_t instance_count = description.instances.size();
+  std::vector<SharedMesh> meshes(instance_count);
+  std::vector<SharedMeshUvs> mesh_uvs(instance_count);
+  std::vector<InstanceState> instances(instance_count);
+  std::vector<DirectX::BoundingBox> bounds(instance_count);
+
+  // Take over unchanged instances and load the mesh sources of the others,
+  // each once.
+  std::vector<bool> kept(meshes_.size(), false);
+  std::vector<size_t> rebuilt{};
+  std::map<std::string, MeshSource> sources{};
+  for (size_t index = 0; index < instance_count; ++index) {
+    if (const auto old_index = diff.kept_instances[index]) {
+      assert(*old_index < meshes_.size());
+      meshes[index] = std::move(meshes_[*old_index]);
+      mesh_uvs[index] = std::move(mesh_uvs_[*old_index]);
+      instances[index] = instances_[*old_index];
+      bounds[index] = bounds_[*old_index];
+      kept[*old_index] = true;
+      ++stats_.kept_instances;
+      continue;
+    }
+    const auto& source =
+        GetMeshSource(description, description.instances[index]);
+    if (!sources.contains(source)) {
+      sources.emplace(source, LoadMeshSource(source));
+    }
+    if (sources.at(source).loaded) {
+      rebuilt.push_back(index);
+      ++stats_.built_instances;
+    } else {
+      // Empty, so that every mesh can be dereferenced.
+      meshes[index] = std::make_shared<const Mesh>();
+      mesh_uvs[index] = std::make_shared<const MeshUvs>();
+      ++stats_.failed_instances;
+    }
+  }
+
+  // Transform the copies and bake the levels of detail of the static ones,
+  // the bulk of the work of a reload.
+  std::for_each(
+      std::execution::par, rebuilt.begin(), rebuilt.end(), [&](size_t index) {
+        auto scope = utils::trace::Scope("build instance");
+        const auto& instance = description.instances[index];
+        const auto& source = sources.at(GetMeshSource(description, instance));
+        auto mesh = source.mesh;
+        auto uvs = source.uvs;
+        ApplyTransforms(mesh, instance.transforms);
+        // Textured meshes without texture coordinates sample the corner of
+        // their texture.
+        if (!instance.material.empty() && uvs.empty()) {
+          uvs.assign(mesh.first.size(), DirectX::XMFLOAT2(0.0f, 0.0f));
+        }
+        bounds[index] = MeshView(mesh.first, mesh.second).GetBounds();
+
+        auto& state = instances[index];
+        state = {.spin = instance.spin,
+                 .stream_handle = std::nullopt,
+                 .lod_name = {},
+                 .level = 0,
+                 .poses = {}};
+        const auto name = "scene_" + std::to_string(generation_) + "_" +
+                          std::to_string(index);
+        if (!instance.spin.has_value() &&
+            WriteLods(mesh, lod_directory_, name, lod_levels_, uvs) != 0) {
+          if (const auto handle = geometry_streamer_.AddMesh(
+                  lod_directory_, name, bounds[index])) {
+            meshes[index] = geometry_streamer_.GetMesh(*handle, state.level,
+                                                       mesh_uvs[index]);
+            state.stream_handle = handle;
+            state.lod_name = name;
+            return;
+          }
+          RemoveLods(lod_directory_, name);
+        }
+        meshes[index] = std::make_shared<const Mesh>(std::move(mesh));
+        mesh_uvs[index] = std::make_shared<const MeshUvs>(std::move(uvs));
+      });
+
+  // Files still open by a streaming thread may fail to delete; they are left
+  // to the owner of the directory.
+  for (size_t old_index = 0; old_index < instances_.size(); ++old_index) {
+    const auto& state = instances_[old_index];
+    if (!kept[old_index] && state.stream_handle.has_value()) {
+      geometry_streamer_.RemoveMesh(*state.stream_handle);
+      RemoveLods(lod_directory_, state.lod_name);
+    }
+  }
+
+  primitives_.clear();
+  for (const auto& primitive : description.primitives) {
+    primitives_.push_back(primitive.primitive);
+    bounds.push_back(GetPrimitiveBounds(primitive.primitive));
+  }
+  textures_.clear();
+  for (const auto& instance : description.instances) {
+    textures_.push_back(
+        GetTexture(description, material_textures, instance.material));
+  }
+  for (const auto& primitive : description.primitives) {
+    textures_.push_back(
+        GetTexture(description, material_textures, primitive.material));
+  }
+
+  meshes_ = std::move(meshes);
+  mesh_uvs_ = std::move(mesh_uvs);
+  instances_ = std::move(instances);
+  bounds_ = std::move(bounds);
+}
+
+void scene::LiveScene::Animate() {
+  for (size_t index = 0; index < instances_.size(); ++index) {
+    auto& state = instances_[index];
+    if (!state.spin.has_value()) {
+      continue;
+    }
+    // Copies of the scene keep the previous pose, so write the new one into a
+    // pose only this scene holds, which reuses its buffers.
+    auto pose = std::ranges::find_if(state.poses, [](const auto& pose) {
+      return pose.use_count() == 1;
+    });
+    if (pose == state.poses.end()) {
+      pose = state.poses.insert(pose, std::make_shared<Mesh>());
+    }
+    // Pairs with the release of the last other owner.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto& mesh = **pose;
+    mesh = *meshes_[index];
+    bounds_[index] = MeshView(mesh.first, mesh.second)
+                         .Rotate(state.spin->x, state.spin->y, state.spin->z)
+                         .GetBounds();
+    meshes_[index] = *pose;
+    ++version_;
+  }
+}
+
+void scene::LiveScene::UpdateLevels() {
+  for (size_t index = 0; index < instances_.size(); ++index) {
+    auto& state = instances_[index];
+    if (!state.stream_handle.has_value()) {
+      continue;
+    }
+    size_t level = 0;
+    SharedMeshUvs uvs{};
+    auto mesh = geometry_streamer_.GetMesh(*state.stream_handle, level, uvs);
+    if (level != state.level) {
+      meshes_[index] = std::move(mesh);
+      mesh_uvs_[index] = std::move(uvs);
+      state.level = level;
+      ++level_version_;
+      ++version_;
+    }
+  }
+}
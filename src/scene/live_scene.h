@@ -0,0 +1,106 @@
+#pragma once
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "geometry_streamer.h"
+#include "mesh.h"
+#include "primitive.h"
+#include "scene_description.h"
+
+namespace scene {
+struct LiveSceneStats {
+  // Instances of the last `Apply` that were built or kept as they were, and
+  // the ones whose mesh could not be loaded.
+  size_t built_instances;
+  size_t kept_instances;
+  size_t failed_instances;
+};
+
+// Meshes, primitives and their bounds built from a scene description, in the
+// layout of `SceneGeometry`. A new description only rebuilds the instances
+// that changed, along with their levels of detail; the others keep their
+// meshes, animation state and streamed levels. Meshes are never modified once
+// built, so copies of the scene share them.
+class LiveScene {
+ public:
+  LiveScene(GeometryStreamer& geometry_streamer,
+            std::filesystem::path lod_directory, size_t lod_levels);
+
+  LiveScene(const LiveScene&) = delete;
+  LiveScene& operator=(const LiveScene&) = delete;
+
+  // Switch to `description`, where `diff` compares it with the previously
+  // applied one and `material_textures` holds the texture of each of its
+  // materials or `SceneGeometry::kNoTexture`.
+  void Apply(const SceneDescription& description, const SceneDiff& diff,
+             std::span<const uint32_t> material_textures);
+
+  // Rotate the spinning instances by one simulation step.
+  void Animate();
+
+  // Swap in levels of detail that finished streaming.
+  void UpdateLevels();
+
+  // Changes whenever `UpdateLevels` swapped the level of an instance.
+  inline uint64_t LevelVersion() const { return level_version_; }
+
+  // Changes whenever anything below changed.
+  inline uint64_t Version() const { return version_; }
+
+  inline const std::vector<SharedMesh>& Meshes() const { return meshes_; }
+
+  inline const std::vector<Primitive>& Primitives() const {
+    return primitives_;
+  }
+
+  // Meshes first, then primitives.
+  inline const std::vector<DirectX::BoundingBox>& Bounds() const {
+    return bounds_;
+  }
+
+  inline const std::vector<SharedMeshUvs>& Uvs() const { return mesh_uvs_; }
+
+  // Meshes first, then primitives.
+  inline const std::vector<uint32_t>& Textures() const { return textures_; }
+
+  inline const LiveSceneStats& GetStats() const { return stats_; }
+
+ private:
+  struct InstanceState {
+    std::optional<DirectX::XMFLOAT3> spin;
+    // Streamed instances only, along with the name of their level files.
+    std::optional<size_t> stream_handle;
+    std::string lod_name;
+    size_t level;
+    // Spinning instances only, poses that were published, reused once no
+    // copy of the scene holds them.
+    std::vector<std::shared_ptr<Mesh>> poses;
+  };
+
+  GeometryStreamer& geometry_streamer_;
+  std::filesystem::path lod_directory_;
+  size_t lod_levels_;
+  // Part of the file names of levels of detail, so that rebuilt instances do
+  // not overwrite files that are still being streamed. Files of removed
+  // instances are deleted, so `lod_directory` should belong to this process.
+  uint64_t generation_ = 0;
+  uint64_t level_version_ = 0;
+  uint64_t version_ = 0;
+  std::vector<SharedMesh> meshes_;
+  std::vector<SharedMeshUvs> mesh_uvs_;
+  std::vector<InstanceState> instances_;
+  std::vector<Primitive> primitives_;
+  std::vector<DirectX::BoundingBox> bounds_;
+  std::vector<uint32_t> textures_;
+  LiveSceneStats stats_{};
+};
+}  // namespace scene
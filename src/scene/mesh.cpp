@@ -1,6 +1,9 @@
 #include "mesh.h"
 
 #include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
 #include <cmath>
 #include <fstream>
 #include <sstream>
@@ -47,3 +50,100 @@ scene::Mesh scene::LoadRectangle() {
 
   return {vertices, indices};
 }
+
+scene::MeshUvs scene::LoadRectangleUvs(float scale) {
+  return {{0.0f, 0.0f}, {scale, 0.0f}, {scale, scale}, {0.0f, scale}};
+}
+
+namespace {
+// Version 2 adds the texture coordinate count after the face count and the
+// texture coordinates after the faces.
+constexpr std::array<char, 4> kMeshFileMagic = {'R', 'T', 'M', '2'};
+constexpr std::array<char, 4> kMeshFileMagicV1 = {'R', 'T', 'M', '1'};
+}  // namespace
+
+bool scene::SaveMesh(const Mesh& mesh, const std::filesystem::path& path,
+                     std::span<const DirectX::XMFLOAT2> uvs) {
+  assert(uvs.empty() || uvs.size() == mesh.first.size());
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+
+  const auto vertex_count = static_cast<uint32_t>(mesh.first.size());
+  const auto face_count = static_cast<uint32_t>(mesh.second.size());
+  const auto uv_count = static_cast<uint32_t>(uvs.size());
+  file.write(kMeshFileMagic.data(), kMeshFileMagic.size());
+  file.write(reinterpret_cast<const char*>(&vertex_count),
+             sizeof(vertex_count));
+  file.write(reinterpret_cast<const char*>(&face_count), sizeof(face_count));
+  file.write(reinterpret_cast<const char*>(&uv_count), sizeof(uv_count));
+  file.write(reinterpret_cast<const char*>(mesh.first.data()),
+             static_cast<std::streamsize>(vertex_count *
+                                          sizeof(DirectX::XMFLOAT3A)));
+  file.write(
+      reinterpret_cast<const char*>(mesh.second.data()),
+      static_cast<std::streamsize>(face_count * sizeof(DirectX::XMINT3)));
+  file.write(
+      reinterpret_cast<const char*>(uvs.data()),
+      static_cast<std::streamsize>(uv_count * sizeof(DirectX::XMFLOAT2)));
+  return static_cast<bool>(file);
+}
+
+std::optional<scene::Mesh> scene::LoadMesh(const std::filesystem::path& path) {
+  MeshUvs uvs{};
+  return LoadMesh(path, uvs);
+}
+
+std::optional<scene::Mesh> scene::LoadMesh(const std::filesystem::path& path,
+                                           MeshUvs& out_uvs) {
+  out_uvs.clear();
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return std::nullopt;
+  }
+
+  std::array<char, 4> magic{};
+  uint32_t vertex_count = 0;
+  uint32_t face_count = 0;
+  uint32_t uv_count = 0;
+  file.read(magic.data(), magic.size());
+  file.read(reinterpret_cast<char*>(&vertex_count), sizeof(vertex_count));
+  file.read(reinterpret_cast<char*>(&face_count), sizeof(face_count));
+  if (magic == kMeshFileMagic) {
+    file.read(reinterpret_cast<char*>(&uv_count), sizeof(uv_count));
+  } else if (magic != kMeshFileMagicV1) {
+    return std::nullopt;
+  }
+  if (!file || (uv_count != 0 && uv_count != vertex_count)) {
+    return std::nullopt;
+  }
+
+  Mesh mesh{};
+  mesh.first.resize(vertex_count);
+  mesh.second.resize(face_count);
+  file.read(reinterpret_cast<char*>(mesh.first.data()),
+            static_cast<std::streamsize>(vertex_count *
+                                         sizeof(DirectX::XMFLOAT3A)));
+  file.read(reinterpret_cast<char*>(mesh.second.data()),
+            static_cast<std::streamsize>(face_count * sizeof(DirectX::XMINT3)));
+  MeshUvs uvs(uv_count);
+  file.read(reinterpret_cast<char*>(uvs.data()),
+            static_cast<std::streamsize>(uv_count * sizeof(DirectX::XMFLOAT2)));
+  if (!file) {
+    return std::nullopt;
+  }
+
+  // Reject files whose faces point outside of the vertex array.
+  const bool valid = std::ranges::all_of(mesh.second, [&](const auto& face) {
+    return std::max({face.x, face.y, face.z}) <
+               static_cast<int32_t>(vertex_count) &&
+           std::min({face.x, face.y, face.z}) >= 0;
+  });
+  if (!valid) {
+    return std::nullopt;
+  }
+
+  out_uvs = std::move(uvs);
+  return mesh;
+}
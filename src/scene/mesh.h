@@ -2,6 +2,8 @@
 
 #include <DirectXMath.h>
 
+#include <filesystem>
+#include <memory>
 #include <optional>
 #include <span>
 #include <string>
@@ -12,9 +14,31 @@ namespace scene {
 using Mesh =
     std::pair<std::vector<DirectX::XMFLOAT3A>, std::vector<DirectX::XMINT3>>;
 
+// Texture coordinates, one per vertex of a mesh.
+using MeshUvs = std::vector<DirectX::XMFLOAT2>;
+
+// Meshes of a published scene never change, so scenes share the ones that
+// stayed the same.
+using SharedMesh = std::shared_ptr<const Mesh>;
+using SharedMeshUvs = std::shared_ptr<const MeshUvs>;
+
 Mesh LoadCube();
 
 Mesh LoadOctahedron();
 
 Mesh LoadRectangle();
+
+// Texture coordinates of `LoadRectangle`, from 0 to `scale` along each side.
+MeshUvs LoadRectangleUvs(float scale);
+
+// Binary mesh files, as written by the LOD generator. Texture coordinates are
+// optional; `uvs` is either empty or holds one per vertex.
+bool SaveMesh(const Mesh& mesh, const std::filesystem::path& path,
+              std::span<const DirectX::XMFLOAT2> uvs = {});
+
+std::optional<Mesh> LoadMesh(const std::filesystem::path& path);
+
+// Also read the texture coordinates; `out_uvs` is empty if the file has none.
+std::optional<Mesh> LoadMesh(const std::filesystem::path& path,
+                             MeshUvs& out_uvs);
 }  // namespace scene
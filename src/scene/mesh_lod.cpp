@@ -0,0 +1,166 @@
+#include "mesh_lod.h"
+
+#include <DirectXCollision.h>
+
+#include <cmath>
+#include <string>
+#include <unordered_map>
+
+namespace {
+inline DirectX::BoundingBox GetBounds(const scene::Mesh& mesh) {
+  DirectX::BoundingBox bbox{};
+  DirectX::BoundingBox::CreateFromPoints(bbox, mesh.first.size(),
+                                         mesh.first.data(),
+                                         sizeof(DirectX::XMFLOAT3A));
+  return bbox;
+}
+
+// Pack a grid cell into a single key (21 bits per axis).
+inline uint64_t GetCellKey(const DirectX::XMFLOAT3A& vertex,
+                           const DirectX::XMFLOAT3& min_corner,
+                           float inverse_cell_size) {
+  constexpr uint64_t kAxisMask = (1ULL << 21U) - 1U;
+  const auto cell = [&](float value, float min_value) {
+    return static_cast<uint64_t>((value - min_value) * inverse_cell_size) &
+           kAxisMask;
+  };
+  return cell(vertex.x, min_corner.x) |
+         (cell(vertex.y, min_corner.y) << 21U) |
+         (cell(vertex.z, min_corner.z) << 42U);
+}
+}  // namespace
+
+scene::Mesh scene::SimplifyMesh(const Mesh& mesh, float cell_size) {
+  MeshUvs uvs{};
+  return SimplifyMesh(mesh, cell_size, {}, uvs);
+}
+
+scene::Mesh scene::SimplifyMesh(const Mesh& mesh, float cell_size,
+                                std::span<const DirectX::XMFLOAT2> uvs,
+                                MeshUvs& out_uvs) {
+  out_uvs.clear();
+  if (mesh.first.empty()) {
+    out_uvs.assign(uvs.begin(), uvs.end());
+    return mesh;
+  }
+
+  const DirectX::BoundingBox bbox = GetBounds(mesh);
+  const DirectX::XMFLOAT3 min_corner(bbox.Center.x - bbox.Extents.x,
+                                     bbox.Center.y - bbox.Extents.y,
+                                     bbox.Center.z - bbox.Extents.z);
+  const float inverse_cell_size = 1.0f / cell_size;
+
+  // Map every vertex to the representative of its cell.
+  std::unordered_map<uint64_t, int32_t> cell_to_vertex{};
+  std::vector<DirectX::XMFLOAT3A> cell_sums{};
+  std::vector<DirectX::XMFLOAT2> cell_uv_sums{};
+  std::vector<float> cell_counts{};
+  std::vector<int32_t> remap(mesh.first.size());
+  for (size_t i = 0; i < mesh.first.size(); ++i) {
+    const auto& vertex = mesh.first[i];
+    const auto key = GetCellKey(vertex, min_corner, inverse_cell_size);
+    const auto [it, inserted] =
+        cell_to_vertex.try_emplace(key, static_cast<int32_t>(cell_sums.size()));
+    if (inserted) {
+      cell_sums.emplace_back(0.0f, 0.0f, 0.0f);
+      cell_uv_sums.emplace_back(0.0f, 0.0f);
+      cell_counts.push_back(0.0f);
+    }
+    const auto cell = static_cast<size_t>(it->second);
+    cell_sums[cell].x += vertex.x;
+    cell_sums[cell].y += vertex.y;
+    cell_sums[cell].z += vertex.z;
+    if (!uvs.empty()) {
+      cell_uv_sums[cell].x += uvs[i].x;
+      cell_uv_sums[cell].y += uvs[i].y;
+    }
+    cell_counts[cell] += 1.0f;
+    remap[i] = it->second;
+  }
+
+  Mesh simplified{};
+  simplified.first.reserve(cell_sums.size());
+  for (size_t cell = 0; cell < cell_sums.size(); ++cell) {
+    const float inverse_count = 1.0f / cell_counts[cell];
+    simplified.first.emplace_back(cell_sums[cell].x * inverse_count,
+                                  cell_sums[cell].y * inverse_count,
+                                  cell_sums[cell].z * inverse_count);
+    if (!uvs.empty()) {
+      out_uvs.emplace_back(cell_uv_sums[cell].x * inverse_count,
+                           cell_uv_sums[cell].y * inverse_count);
+    }
+  }
+
+  for (const auto& face : mesh.second) {
+    const DirectX::XMINT3 remapped(remap[static_cast<size_t>(face.x)],
+                                   remap[static_cast<size_t>(face.y)],
+                                   remap[static_cast<size_t>(face.z)]);
+    if (remapped.x != remapped.y && remapped.y != remapped.z &&
+        remapped.x != remapped.z) {
+      simplified.second.push_back(remapped);
+    }
+  }
+
+  return simplified;
+}
+
+std::filesystem::path scene::GetLodPath(const std::filesystem::path& directory,
+                                        std::string_view name, size_t level) {
+  return directory /
+         (std::string(name) + "_lod" + std::to_string(level) + ".mesh");
+}
+
+void scene::RemoveLods(const std::filesystem::path& directory,
+                       std::string_view name, size_t first_level) {
+  // A level that fails to delete, e.g. while it is open, does not stop the
+  // coarser ones from being deleted.
+  for (size_t level = first_level;; ++level) {
+    const auto path = GetLodPath(directory, name, level);
+    std::error_code error{};
+    if (!std::filesystem::exists(path, error)) {
+      break;
+    }
+    std::filesystem::remove(path, error);
+  }
+}
+
+size_t scene::WriteLods(const Mesh& mesh,
+                        const std::filesystem::path& directory,
+                        std::string_view name, size_t max_levels,
+                        std::span<const DirectX::XMFLOAT2> uvs) {
+  RemoveLods(directory, name);
+  std::error_code error{};
+  std::filesystem::create_directories(directory, error);
+  if (error || !SaveMesh(mesh, GetLodPath(directory, name, 0), uvs)) {
+    return 0;
+  }
+
+  // Start with cells of 1/64 of the largest extent and double them per level.
+  if (mesh.first.empty()) {
+    return 1;
+  }
+  const DirectX::BoundingBox bbox = GetBounds(mesh);
+  float cell_size =
+      std::fmaxf(bbox.Extents.x, std::fmaxf(bbox.Extents.y, bbox.Extents.z)) /
+      32.0f;
+
+  size_t level_count = 1;
+  size_t previous_face_count = mesh.second.size();
+  while (level_count < max_levels && cell_size > 0.0f) {
+    MeshUvs level_uvs{};
+    const Mesh level = SimplifyMesh(mesh, cell_size, uvs, level_uvs);
+    cell_size *= 2.0f;
+    if (level.second.size() >= previous_face_count) {
+      continue;
+    }
+    if (level.second.empty() ||
+        !SaveMesh(level, GetLodPath(directory, name, level_count),
+                  level_uvs)) {
+      break;
+    }
+    previous_face_count = level.second.size();
+    ++level_count;
+  }
+
+  return level_count;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+#include "mesh.h"
+
+namespace scene {
+// Simplify a mesh by vertex clustering: vertices in the same grid cell are
+// merged into their average and faces that collapse are dropped.
+Mesh SimplifyMesh(const Mesh& mesh, float cell_size);
+
+// Also merge the texture coordinates of `mesh`, one per vertex, into the
+// average of each cell.
+Mesh SimplifyMesh(const Mesh& mesh, float cell_size,
+                  std::span<const DirectX::XMFLOAT2> uvs, MeshUvs& out_uvs);
+
+// File of level `level` of the mesh `name`; level 0 is the full mesh.
+std::filesystem::path GetLodPath(const std::filesystem::path& directory,
+                                 std::string_view name, size_t level);
+
+// Delete the consecutive levels of the mesh `name` from `first_level` on.
+void RemoveLods(const std::filesystem::path& directory, std::string_view name,
+                size_t first_level = 0);
+
+// Offline step: write up to `max_levels` levels of detail of `mesh`, each
+// with a cell size twice as large as the previous one. Stops early once a
+// level would no longer reduce the face count. Levels left over from an
+// earlier bake of `name` are deleted first, so readers that probe for
+// consecutive levels find exactly the ones written. Returns the number of
+// levels written, or 0 on failure. Texture coordinates in `uvs` are optional.
+size_t WriteLods(const Mesh& mesh, const std::filesystem::path& directory,
+                 std::string_view name, size_t max_levels,
+                 std::span<const DirectX::XMFLOAT2> uvs = {});
+}  // namespace scene
@@ -38,9 +38,7 @@ class MeshView {
 
   inline MeshView& Normalize() {
     // Compute the bounding box of the mesh.
-    DirectX::BoundingBox bbox{};
-    DirectX::BoundingBox::CreateFromPoints(
-        bbox, vertices_.size(), &vertices_[0], sizeof(DirectX::XMFLOAT3A));
+    const DirectX::BoundingBox bbox = GetBounds();
 
     // Calculate the scale factor to normalize the dimensions to fit within a
     // unit cube.
@@ -80,6 +78,16 @@ class MeshView {
     return *this;
   }
 
+  // Axis-aligned bounds of the vertices in their current (world) space.
+  inline DirectX::BoundingBox GetBounds() const {
+    DirectX::BoundingBox bbox{};
+    if (!vertices_.empty()) {
+      DirectX::BoundingBox::CreateFromPoints(
+          bbox, vertices_.size(), &vertices_[0], sizeof(DirectX::XMFLOAT3A));
+    }
+    return bbox;
+  }
+
  private:
   inline MeshView& ApplyTransform(DirectX::CXMMATRIX transform) {
     for (auto& vertex : vertices_) {
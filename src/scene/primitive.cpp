@@ -0,0 +1,175 @@
+#include "primitive.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+
+#include "../utils/xm.h"
+
+namespace {
+// Half extent of plane bounds, beyond the farthest distance that is rendered.
+constexpr auto kPlaneExtent = 1.0e5f;
+
+// Tangent and bitangent spanning a plane, the texture axes.
+inline void GetPlaneAxes(DirectX::XMVECTOR& out_tangent,
+                         DirectX::XMVECTOR& out_bitangent,
+                         DirectX::FXMVECTOR normal) {
+  const auto reference = std::fabs(DirectX::XMVectorGetY(normal)) < 0.999f
+                             ? DirectX::g_XMIdentityR1
+                             : DirectX::g_XMIdentityR0;
+  out_tangent =
+      DirectX::XMVector3Normalize(DirectX::XMVector3Cross(normal, reference));
+  out_bitangent = DirectX::XMVector3Cross(normal, out_tangent);
+}
+}  // namespace
+
+scene::Primitive scene::MakeSphere(const DirectX::XMFLOAT3& center,
+                                   float radius) {
+  return {.type = PrimitiveType::kSphere,
+          .position = {center.x, center.y, center.z},
+          .size = {radius, radius, radius},
+          .uv_scale = 1.0f};
+}
+
+scene::Primitive scene::MakePlane(const DirectX::XMFLOAT3& point,
+                                  const DirectX::XMFLOAT3& normal,
+                                  float uv_scale) {
+  return {.type = PrimitiveType::kPlane,
+          .position = {point.x, point.y, point.z},
+          .size = utils::xm::float3a::Store(
+              DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&normal))),
+          .uv_scale = uv_scale};
+}
+
+scene::Primitive scene::MakeBox(const DirectX::XMFLOAT3& center,
+                                const DirectX::XMFLOAT3& extents,
+                                float uv_scale) {
+  return {.type = PrimitiveType::kBox,
+          .position = {center.x, center.y, center.z},
+          .size = {extents.x, extents.y, extents.z},
+          .uv_scale = uv_scale};
+}
+
+DirectX::BoundingBox scene::GetPrimitiveBounds(const Primitive& primitive) {
+  const auto& position = primitive.position;
+  const auto& size = primitive.size;
+  switch (primitive.type) {
+    case PrimitiveType::kSphere:
+      return {{position.x, position.y, position.z}, {size.x, size.x, size.x}};
+    case PrimitiveType::kPlane: {
+      // Within `kPlaneExtent` of the point along the other two axes, the plane
+      // moves along an axis by the sum of their normal components over its own.
+      const auto extent = [](float normal, float other_a, float other_b) {
+        const float rise = std::fabs(other_a) + std::fabs(other_b);
+        return rise >= std::fabs(normal)
+                   ? kPlaneExtent
+                   : kPlaneExtent * rise / std::fabs(normal);
+      };
+      return {{position.x, position.y, position.z},
+              {extent(size.x, size.y, size.z), extent(size.y, size.z, size.x),
+               extent(size.z, size.x, size.y)}};
+    }
+    case PrimitiveType::kBox:
+      return {{position.x, position.y, position.z}, {size.x, size.y, size.z}};
+  }
+  return {};
+}
+
+std::optional<float> scene::IntersectPrimitive(const Primitive& primitive,
+                                               DirectX::FXMVECTOR origin,
+                                               DirectX::FXMVECTOR direction,
+                                               float min_distance) {
+  const auto position = DirectX::XMLoadFloat3A(&primitive.position);
+  switch (primitive.type) {
+    case PrimitiveType::kSphere:
+      return utils::xm::sphere::Intersect(position, primitive.size.x, origin,
+                                          direction, min_distance);
+    case PrimitiveType::kPlane:
+      return utils::xm::plane::Intersect(
+          position, DirectX::XMLoadFloat3A(&primitive.size), origin,
+          direction, min_distance);
+    case PrimitiveType::kBox:
+      return utils::xm::box::Intersect(
+          position, DirectX::XMLoadFloat3A(&primitive.size), origin,
+          direction, min_distance);
+  }
+  return std::nullopt;
+}
+
+DirectX::XMFLOAT2 scene::GetPrimitiveUv(const Primitive& primitive,
+                                        DirectX::FXMVECTOR point,
+                                        uint32_t& out_face) {
+  out_face = 0;
+  const auto offset = DirectX::XMVectorSubtract(
+      point, DirectX::XMLoadFloat3A(&primitive.position));
+  switch (primitive.type) {
+    case PrimitiveType::kSphere: {
+      DirectX::XMFLOAT3 direction{};
+      DirectX::XMStoreFloat3(&direction, DirectX::XMVector3Normalize(offset));
+      return {std::atan2(direction.z, direction.x) /
+                      (2.0f * std::numbers::pi_v<float>) +
+                  0.5f,
+              std::acos(std::clamp(direction.y, -1.0f, 1.0f)) /
+                  std::numbers::pi_v<float>};
+    }
+    case PrimitiveType::kPlane: {
+      DirectX::XMVECTOR tangent{};
+      DirectX::XMVECTOR bitangent{};
+      GetPlaneAxes(tangent, bitangent,
+                   DirectX::XMLoadFloat3A(&primitive.size));
+      return {DirectX::XMVectorGetX(DirectX::XMVector3Dot(offset, tangent)) *
+                  primitive.uv_scale,
+              DirectX::XMVectorGetX(
+                  DirectX::XMVector3Dot(offset, bitangent)) *
+                  primitive.uv_scale};
+    }
+    case PrimitiveType::kBox: {
+      // The face is on the axis where the point is relatively farthest out.
+      DirectX::XMFLOAT3 local{};
+      DirectX::XMStoreFloat3(&local, offset);
+      const std::array<float, 3> coordinates = {local.x, local.y, local.z};
+      const std::array<float, 3> extents = {
+          primitive.size.x, primitive.size.y, primitive.size.z};
+      uint32_t axis = 0;
+      for (uint32_t i = 1; i < 3; ++i) {
+        if (std::fabs(coordinates[i]) * extents[axis] >
+            std::fabs(coordinates[axis]) * extents[i]) {
+          axis = i;
+        }
+      }
+      out_face = 2 * axis + (coordinates[axis] > 0.0f ? 1 : 0);
+      return {coordinates[(axis + 1) % 3] * primitive.uv_scale,
+              coordinates[(axis + 2) % 3] * primitive.uv_scale};
+    }
+  }
+  return {};
+}
+
+DirectX::XMVECTOR scene::GetPrimitiveNormal(const Primitive& primitive,
+                                            DirectX::FXMVECTOR point,
+                                            uint32_t face) {
+  switch (primitive.type) {
+    case PrimitiveType::kSphere:
+      return DirectX::XMVectorScale(
+          DirectX::XMVectorSubtract(
+              point, DirectX::XMLoadFloat3A(&primitive.position)),
+          1.0f / primitive.size.x);
+    case PrimitiveType::kPlane:
+      return DirectX::XMLoadFloat3A(&primitive.size);
+    case PrimitiveType::kBox: {
+      std::array<float, 3> normal{};
+      normal[face / 2] = face % 2 == 1 ? 1.0f : -1.0f;
+      return DirectX::XMVectorSet(normal[0], normal[1], normal[2], 0.0f);
+    }
+  }
+  return DirectX::g_XMIdentityR1;
+}
+
+float scene::GetPrimitiveUvDensity(const Primitive& primitive) {
+  if (primitive.type == PrimitiveType::kSphere) {
+    return 1.0f / (4.0f * std::numbers::pi_v<float> * primitive.size.x *
+                   primitive.size.x);
+  }
+  return primitive.uv_scale * primitive.uv_scale;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <optional>
+
+namespace scene {
+enum class PrimitiveType { kSphere, kPlane, kBox };
+
+// Analytic surface, intersected in closed form instead of as triangles.
+struct Primitive {
+  PrimitiveType type;
+  // Center of a sphere or box, or a point on a plane.
+  DirectX::XMFLOAT3A position;
+  // Radius of a sphere in `x`, unit normal of a plane, or half extents of an
+  // axis aligned box.
+  DirectX::XMFLOAT3A size;
+  // Texture coordinates per unit of length on planes and boxes. Spheres are
+  // mapped once by longitude and latitude.
+  float uv_scale;
+};
+
+Primitive MakeSphere(const DirectX::XMFLOAT3& center, float radius);
+
+Primitive MakePlane(const DirectX::XMFLOAT3& point,
+                    const DirectX::XMFLOAT3& normal, float uv_scale);
+
+Primitive MakeBox(const DirectX::XMFLOAT3& center,
+                  const DirectX::XMFLOAT3& extents, float uv_scale);
+
+// World space bounds. Planes are cut off far beyond anything that is
+// rendered; along each axis their bounds reach only as far as the slope of the
+// plane takes them, so planes facing along an axis have flat bounds.
+DirectX::BoundingBox GetPrimitiveBounds(const Primitive& primitive);
+
+// Distance along the unit `direction` to the first intersection at or beyond
+// `min_distance`.
+std::optional<float> IntersectPrimitive(const Primitive& primitive,
+                                        DirectX::FXMVECTOR origin,
+                                        DirectX::FXMVECTOR direction,
+                                        float min_distance);
+
+// Texture coordinates at `point` on the surface, and for boxes the face that
+// holds it, `2 * axis` on the lower and `2 * axis + 1` on the upper side.
+DirectX::XMFLOAT2 GetPrimitiveUv(const Primitive& primitive,
+                                 DirectX::FXMVECTOR point,
+                                 uint32_t& out_face);
+
+// Unit normal at the surface `point` on `face`, as returned by
+// `GetPrimitiveUv`.
+DirectX::XMVECTOR GetPrimitiveNormal(const Primitive& primitive,
+                                     DirectX::FXMVECTOR point, uint32_t face);
+
+// Area in texture space per unit of surface area.
+float GetPrimitiveUvDensity(const Primitive& primitive);
+}  // namespace scene
@@ -0,0 +1,474 @@
+#include "scene_description.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+
+namespace {
+// Whitespace separated words of a line, read front to back.
+class Tokens {
+ public:
+  inline explicit Tokens(std::string_view line) {
+    size_t begin = line.find_first_not_of(" \t\r");
+    while (begin != std::string_view::npos) {
+      const size_t end = std::min(line.find_first_of(" \t\r", begin),
+                                  line.size());
+      words_.push_back(line.substr(begin, end - begin));
+      begin = line.find_first_not_of(" \t\r", end);
+    }
+  }
+
+  inline bool Empty() const { return next_ == words_.size(); }
+
+  inline std::optional<std::string_view> Next() {
+    if (Empty()) {
+      return std::nullopt;
+    }
+    return words_[next_++];
+  }
+
+  inline std::optional<float> NextFloat() {
+    const auto word = Next();
+    float value = 0.0f;
+    if (!word.has_value() || !Convert(*word, value)) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  inline std::optional<DirectX::XMFLOAT3> NextFloat3() {
+    const auto x = NextFloat();
+    const auto y = NextFloat();
+    const auto z = NextFloat();
+    if (!x.has_value() || !y.has_value() || !z.has_value()) {
+      return std::nullopt;
+    }
+    return DirectX::XMFLOAT3(*x, *y, *z);
+  }
+
+  // Greater than zero.
+  inline std::optional<unsigned int> NextCount() {
+    const auto word = Next();
+    unsigned int value = 0;
+    if (!word.has_value() || !Convert(*word, value) || value == 0) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  // `rrggbb` in hexadecimal, as an opaque texel.
+  inline std::optional<uint32_t> NextColor() {
+    const auto word = Next();
+    uint32_t rgb = 0;
+    if (!word.has_value() || word->size() != 6 || !Convert(*word, rgb, 16)) {
+      return std::nullopt;
+    }
+    return ((rgb >> 16U) & 0xFFU) | (rgb & 0xFF00U) | ((rgb & 0xFFU) << 16U) |
+           0xFF000000U;
+  }
+
+ private:
+  template <typename T, typename... Base>
+  static inline bool Convert(std::string_view word, T& out_value,
+                             Base... base) {
+    const auto result = std::from_chars(word.data(), word.data() + word.size(),
+                                        out_value, base...);
+    return result.ec == std::errc() && result.ptr == word.data() + word.size();
+  }
+
+  std::vector<std::string_view> words_;
+  size_t next_ = 0;
+};
+
+template <typename T>
+inline const T* FindByName(const std::vector<T>& items,
+                           std::string_view name) {
+  const auto found = std::ranges::find(items, name, &T::name);
+  return found == items.end() ? nullptr : &*found;
+}
+
+// Name of a new item of `items`.
+template <typename T>
+inline std::optional<std::string> ParseNewName(Tokens& tokens,
+                                               const std::vector<T>& items,
+                                               std::string& out_error) {
+  const auto name = tokens.Next();
+  if (!name.has_value()) {
+    out_error = "expected a name";
+    return std::nullopt;
+  }
+  if (FindByName(items, *name) != nullptr) {
+    out_error = "'" + std::string(*name) + "' is already defined";
+    return std::nullopt;
+  }
+  return std::string(*name);
+}
+
+// Name of a material after `material`.
+inline bool ParseMaterialReference(Tokens& tokens,
+                                   const scene::SceneDescription& description,
+                                   std::string& out_material,
+                                   std::string& out_error) {
+  const auto name = tokens.Next();
+  if (!name.has_value() ||
+      FindByName(description.materials, *name) == nullptr) {
+    out_error = "expected a defined material";
+    return false;
+  }
+  out_material = *name;
+  return true;
+}
+
+bool ParseMaterial(Tokens& tokens, scene::SceneDescription& description,
+                   std::string& out_error) {
+  auto name = ParseNewName(tokens, description.materials, out_error);
+  if (!name.has_value()) {
+    return false;
+  }
+  scene::MaterialDescription material{.name = std::move(*name),
+                                      .sources = {}};
+  while (const auto keyword = tokens.Next()) {
+    scene::MaterialSource source{.type = scene::MaterialSourceType::kColor,
+                                 .path = {},
+                                 .size = 0,
+                                 .squares = 0,
+                                 .color_a = 0,
+                                 .color_b = 0};
+    if (*keyword == "image") {
+      const auto path = tokens.Next();
+      if (!path.has_value()) {
+        out_error = "expected an image path";
+        return false;
+      }
+      source.type = scene::MaterialSourceType::kImage;
+      source.path = *path;
+    } else if (*keyword == "checker") {
+      const auto size = tokens.NextCount();
+      const auto squares = tokens.NextCount();
+      const auto color_a = tokens.NextColor();
+      const auto color_b = tokens.NextColor();
+      if (!size.has_value() || !squares.has_value() || !color_a.has_value() ||
+          !color_b.has_value()) {
+        out_error = "expected a size, a square count and two colors";
+        return false;
+      }
+      source.type = scene::MaterialSourceType::kChecker;
+      source.size = *size;
+      source.squares = *squares;
+      source.color_a = *color_a;
+      source.color_b = *color_b;
+    } else if (*keyword == "color") {
+      const auto color = tokens.NextColor();
+      if (!color.has_value()) {
+        out_error = "expected a color";
+        return false;
+      }
+      source.color_a = *color;
+    } else {
+      out_error = "unknown material source '" + std::string(*keyword) + "'";
+      return false;
+    }
+    material.sources.push_back(std::move(source));
+  }
+  if (material.sources.empty()) {
+    out_error = "expected a material source";
+    return false;
+  }
+  description.materials.push_back(std::move(material));
+  return true;
+}
+
+bool ParseMesh(Tokens& tokens, scene::SceneDescription& description,
+               std::string& out_error) {
+  auto name = ParseNewName(tokens, description.meshes, out_error);
+  if (!name.has_value()) {
+    return false;
+  }
+  const auto source = tokens.Next();
+  if (!source.has_value()) {
+    out_error = "expected a shape or a mesh file";
+    return false;
+  }
+  description.meshes.push_back(
+      {.name = std::move(*name), .source = std::string(*source)});
+  return true;
+}
+
+bool ParseInstance(Tokens& tokens, scene::SceneDescription& description,
+                   std::string& out_error) {
+  auto name = ParseNewName(tokens, description.instances, out_error);
+  if (!name.has_value()) {
+    return false;
+  }
+  const auto mesh = tokens.Next();
+  if (!mesh.has_value() || FindByName(description.meshes, *mesh) == nullptr) {
+    out_error = "expected a defined mesh";
+    return false;
+  }
+  scene::InstanceDescription instance{.name = std::move(*name),
+                                      .mesh = std::string(*mesh),
+                                      .material = {},
+                                      .transforms = {},
+                                      .spin = std::nullopt};
+  while (const auto keyword = tokens.Next()) {
+    if (*keyword == "material") {
+      if (!ParseMaterialReference(tokens, description, instance.material,
+                                  out_error)) {
+        return false;
+      }
+    } else if (*keyword == "translate" || *keyword == "rotate" ||
+               *keyword == "scale") {
+      const auto values = tokens.NextFloat3();
+      if (!values.has_value()) {
+        out_error = "expected three numbers after '" + std::string(*keyword) +
+                    "'";
+        return false;
+      }
+      instance.transforms.push_back(
+          {.type = *keyword == "translate" ? scene::TransformType::kTranslate
+                   : *keyword == "rotate"  ? scene::TransformType::kRotate
+                                           : scene::TransformType::kScale,
+           .values = *values});
+    } else if (*keyword == "spin") {
+      const auto values = tokens.NextFloat3();
+      if (!values.has_value()) {
+        out_error = "expected three numbers after 'spin'";
+        return false;
+      }
+      instance.spin = *values;
+    } else {
+      out_error = "unknown instance option '" + std::string(*keyword) + "'";
+      return false;
+    }
+  }
+  description.instances.push_back(std::move(instance));
+  return true;
+}
+
+bool ParsePrimitive(std::string_view type, Tokens& tokens,
+                    scene::SceneDescription& description,
+                    std::string& out_error) {
+  auto name = ParseNewName(tokens, description.primitives, out_error);
+  if (!name.has_value()) {
+    return false;
+  }
+  const auto position = tokens.NextFloat3();
+  std::optional<DirectX::XMFLOAT3> size{};
+  if (type == "sphere") {
+    if (const auto radius = tokens.NextFloat()) {
+      size = DirectX::XMFLOAT3(*radius, *radius, *radius);
+    }
+  } else {
+    size = tokens.NextFloat3();
+  }
+  if (!position.has_value() || !size.has_value()) {
+    out_error = type == "sphere" ? "expected a center and a radius"
+                : type == "plane" ? "expected a point and a normal"
+                                  : "expected a center and extents";
+    return false;
+  }
+  float uv_scale = 1.0f;
+  std::string material{};
+  while (const auto keyword = tokens.Next()) {
+    if (*keyword == "material") {
+      if (!ParseMaterialReference(tokens, description, material, out_error)) {
+        return false;
+      }
+    } else if (*keyword == "uv" && type != "sphere") {
+      const auto scale = tokens.NextFloat();
+      if (!scale.has_value()) {
+        out_error = "expected a number after 'uv'";
+        return false;
+      }
+      uv_scale = *scale;
+    } else {
+      out_error = "unknown " + std::string(type) + " option '" +
+                  std::string(*keyword) + "'";
+      return false;
+    }
+  }
+
+  scene::Primitive primitive{};
+  if (type == "sphere") {
+    primitive = scene::MakeSphere(*position, size->x);
+  } else if (type == "plane") {
+    if (size->x == 0.0f && size->y == 0.0f && size->z == 0.0f) {
+      out_error = "the normal of a plane must not be zero";
+      return false;
+    }
+    primitive = scene::MakePlane(*position, *size, uv_scale);
+  } else {
+    primitive = scene::MakeBox(*position, *size, uv_scale);
+  }
+  description.primitives.push_back({.name = std::move(*name),
+                                    .primitive = primitive,
+                                    .material = std::move(material)});
+  return true;
+}
+
+bool ParseLight(Tokens& tokens, scene::SceneDescription& description,
+                std::string& out_error) {
+  const auto position = tokens.NextFloat3();
+  if (!position.has_value()) {
+    out_error = "expected a position";
+    return false;
+  }
+  description.light_positions.emplace_back(position->x, position->y,
+                                           position->z);
+  return true;
+}
+
+bool ParseCamera(Tokens& tokens, scene::SceneDescription& description,
+                 std::string& out_error) {
+  if (description.camera.has_value()) {
+    out_error = "the camera is already defined";
+    return false;
+  }
+  const auto position = tokens.NextFloat3();
+  const auto pitch = tokens.NextFloat();
+  const auto yaw = tokens.NextFloat();
+  if (!position.has_value() || !pitch.has_value() || !yaw.has_value()) {
+    out_error = "expected a position, a pitch and a yaw";
+    return false;
+  }
+  description.camera = {.position = *position, .pitch = *pitch, .yaw = *yaw};
+  return true;
+}
+
+inline bool Equal(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+inline bool Equal(const scene::MaterialSource& a,
+                  const scene::MaterialSource& b) {
+  return a.type == b.type && a.path == b.path && a.size == b.size &&
+         a.squares == b.squares && a.color_a == b.color_a &&
+         a.color_b == b.color_b;
+}
+
+inline bool Equal(const scene::TransformStep& a,
+                  const scene::TransformStep& b) {
+  return a.type == b.type && Equal(a.values, b.values);
+}
+
+// Whether an instance of the old description yields the same mesh as one of
+// the new description, including the source of its mesh.
+bool IsSameInstance(const scene::SceneDescription& old_description,
+                    const scene::InstanceDescription& old_instance,
+                    const scene::SceneDescription& new_description,
+                    const scene::InstanceDescription& new_instance) {
+  const auto* old_mesh = FindByName(old_description.meshes, old_instance.mesh);
+  const auto* new_mesh = FindByName(new_description.meshes, new_instance.mesh);
+  return old_mesh != nullptr && new_mesh != nullptr &&
+         old_mesh->source == new_mesh->source &&
+         old_instance.material == new_instance.material &&
+         std::ranges::equal(old_instance.transforms, new_instance.transforms,
+                            [](const auto& a, const auto& b) {
+                              return Equal(a, b);
+                            }) &&
+         old_instance.spin.has_value() == new_instance.spin.has_value() &&
+         (!old_instance.spin.has_value() ||
+          Equal(*old_instance.spin, *new_instance.spin));
+}
+}  // namespace
+
+std::optional<scene::SceneDescription> scene::ParseSceneDescription(
+    std::string_view text, std::string& out_error) {
+  SceneDescription description{};
+  size_t line_number = 0;
+  while (!text.empty()) {
+    ++line_number;
+    const size_t line_end = std::min(text.find('\n'), text.size());
+    auto line = text.substr(0, line_end);
+    text.remove_prefix(std::min(line_end + 1, text.size()));
+    line = line.substr(0, line.find('#'));
+
+    auto tokens = Tokens(line);
+    const auto keyword = tokens.Next();
+    if (!keyword.has_value()) {
+      continue;
+    }
+    std::string error{};
+    bool parsed = false;
+    if (*keyword == "material") {
+      parsed = ParseMaterial(tokens, description, error);
+    } else if (*keyword == "mesh") {
+      parsed = ParseMesh(tokens, description, error);
+    } else if (*keyword == "instance") {
+      parsed = ParseInstance(tokens, description, error);
+    } else if (*keyword == "sphere" || *keyword == "plane" ||
+               *keyword == "box") {
+      parsed = ParsePrimitive(*keyword, tokens, description, error);
+    } else if (*keyword == "light") {
+      parsed = ParseLight(tokens, description, error);
+    } else if (*keyword == "camera") {
+      parsed = ParseCamera(tokens, description, error);
+    } else {
+      error = "unknown statement '" + std::string(*keyword) + "'";
+    }
+    if (parsed && !tokens.Empty()) {
+      parsed = false;
+      error = "unexpected '" + std::string(*tokens.Next()) + "'";
+    }
+    if (!parsed) {
+      out_error = "line " + std::to_string(line_number) + ": " + error;
+      return std::nullopt;
+    }
+  }
+  return description;
+}
+
+std::optional<scene::SceneDescription> scene::LoadSceneDescription(
+    const std::filesystem::path& path, std::string& out_error) {
+  std::ifstream file(path);
+  if (!file) {
+    out_error = "cannot open " + path.string();
+    return std::nullopt;
+  }
+  std::stringstream text{};
+  text << file.rdbuf();
+  return ParseSceneDescription(text.str(), out_error);
+}
+
+scene::SceneDiff scene::DiffSceneDescriptions(
+    const SceneDescription& old_description,
+    const SceneDescription& new_description) {
+  SceneDiff diff{.kept_instances = {},
+                 .kept_materials = {},
+                 .camera_changed = false};
+  for (const auto& instance : new_description.instances) {
+    const auto* old_instance =
+        FindByName(old_description.instances, instance.name);
+    diff.kept_instances.push_back(
+        old_instance != nullptr &&
+                IsSameInstance(old_description, *old_instance,
+                               new_description, instance)
+            ? std::optional<size_t>(static_cast<size_t>(
+                  old_instance - old_description.instances.data()))
+            : std::nullopt);
+  }
+  for (const auto& material : new_description.materials) {
+    const auto* old_material =
+        FindByName(old_description.materials, material.name);
+    diff.kept_materials.push_back(
+        old_material != nullptr &&
+                std::ranges::equal(old_material->sources, material.sources,
+                                   [](const auto& a, const auto& b) {
+                                     return Equal(a, b);
+                                   })
+            ? std::optional<size_t>(static_cast<size_t>(
+                  old_material - old_description.materials.data()))
+            : std::nullopt);
+  }
+
+  const auto& old_camera = old_description.camera;
+  const auto& new_camera = new_description.camera;
+  diff.camera_changed =
+      old_camera.has_value() != new_camera.has_value() ||
+      (new_camera.has_value() &&
+       (!Equal(old_camera->position, new_camera->position) ||
+        old_camera->pitch != new_camera->pitch ||
+        old_camera->yaw != new_camera->yaw));
+  return diff;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "primitive.h"
+
+namespace scene {
+enum class TransformType { kTranslate, kRotate, kScale };
+
+// One step of the transform chain of an instance, applied in order like the
+// calls on a `MeshView`.
+struct TransformStep {
+  TransformType type;
+  DirectX::XMFLOAT3 values;
+};
+
+enum class MaterialSourceType { kImage, kChecker, kColor };
+
+// Where the texture of a material comes from. Colors are in the texel format
+// of textures; a plain color uses `color_a`.
+struct MaterialSource {
+  MaterialSourceType type;
+  std::filesystem::path path;
+  unsigned int size;
+  unsigned int squares;
+  uint32_t color_a;
+  uint32_t color_b;
+};
+
+// A texture, taken from the first of `sources` that can be loaded.
+struct MaterialDescription {
+  std::string name;
+  std::vector<MaterialSource> sources;
+};
+
+// Vertices shared by instances: a built-in shape (`cube`, `octahedron`,
+// `rectangle`) or the path of a mesh file.
+struct MeshDescription {
+  std::string name;
+  std::string source;
+};
+
+// A copy of a mesh placed in the world. Instances that spin rotate by `spin`
+// every simulation step and stay resident; the others stream their levels of
+// detail.
+struct InstanceDescription {
+  std::string name;
+  std::string mesh;
+  // Empty for none.
+  std::string material;
+  std::vector<TransformStep> transforms;
+  std::optional<DirectX::XMFLOAT3> spin;
+};
+
+struct PrimitiveDescription {
+  std::string name;
+  Primitive primitive;
+  // Empty for none.
+  std::string material;
+};
+
+struct CameraDescription {
+  DirectX::XMFLOAT3 position;
+  // In degrees, like `FpsCamera`.
+  float pitch;
+  float yaw;
+};
+
+struct SceneDescription {
+  std::vector<MaterialDescription> materials;
+  std::vector<MeshDescription> meshes;
+  std::vector<InstanceDescription> instances;
+  std::vector<PrimitiveDescription> primitives;
+  std::vector<DirectX::XMFLOAT3A> light_positions;
+  std::optional<CameraDescription> camera;
+};
+
+// What has to be rebuilt to go from one description to the next. Instances
+// and materials are matched by name.
+struct SceneDiff {
+  // For each instance and material of the new description, the index of the
+  // identical one in the old description, or none if it is new or changed.
+  std::vector<std::optional<size_t>> kept_instances;
+  std::vector<std::optional<size_t>> kept_materials;
+  bool camera_changed;
+};
+
+// Text scene format, one statement per line and `#` starting a comment:
+//
+//   material <name> (image <path> | checker <size> <squares> <rrggbb> <rrggbb>
+//                    | color <rrggbb>)...
+//   mesh <name> <cube | octahedron | rectangle | mesh file path>
+//   instance <name> <mesh> [material <name>]
+//            [translate|rotate|scale <x> <y> <z>]... [spin <x> <y> <z>]
+//   sphere <name> <x> <y> <z> <radius> [material <name>]
+//   plane <name> <x> <y> <z> <normal x> <normal y> <normal z> [uv <scale>]
+//         [material <name>]
+//   box <name> <x> <y> <z> <extent x> <extent y> <extent z> [uv <scale>]
+//       [material <name>]
+//   light <x> <y> <z>
+//   camera <x> <y> <z> <pitch> <yaw>
+//
+// Names are unique per kind and referenced after their definition. On errors,
+// `out_error` holds the line and the reason.
+std::optional<SceneDescription> ParseSceneDescription(std::string_view text,
+                                                      std::string& out_error);
+
+std::optional<SceneDescription> LoadSceneDescription(
+    const std::filesystem::path& path, std::string& out_error);
+
+SceneDiff DiffSceneDescriptions(const SceneDescription& old_description,
+                                const SceneDescription& new_description);
+}  // namespace scene
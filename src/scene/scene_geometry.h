@@ -0,0 +1,30 @@
+#pragma once
+
+#include <DirectXCollision.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "mesh.h"
+#include "primitive.h"
+
+namespace scene {
+// Meshes, analytic primitives and their world space bounds. Published when
+// the scene changed and never modified afterwards, so the renderer and ray
+// queries on other threads can hold on to it; meshes that did not change are
+// shared with earlier ones. Bounds, textures and hits index the meshes first
+// and the primitives after them.
+struct SceneGeometry {
+  static constexpr uint32_t kNoTexture = std::numeric_limits<uint32_t>::max();
+
+  std::vector<SharedMesh> meshes;
+  std::vector<Primitive> primitives;
+  std::vector<DirectX::BoundingBox> bounds;
+  // Texture coordinates of each mesh, empty for untextured ones.
+  std::vector<SharedMeshUvs> mesh_uvs;
+  // Texture cache index of each mesh and primitive or `kNoTexture`; empty if
+  // nothing is textured.
+  std::vector<uint32_t> textures;
+};
+}  // namespace scene
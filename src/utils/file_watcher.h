@@ -0,0 +1,37 @@
+#pragma once
+
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+namespace utils::file {
+// Reports changes of one file by comparing its last write time between polls.
+// A missing file counts as a change once, when it disappears.
+class FileWatcher {
+ public:
+  inline explicit FileWatcher(std::filesystem::path path)
+      : path_(std::move(path)), last_write_time_(GetLastWriteTime()) {}
+
+  inline const std::filesystem::path& Path() const { return path_; }
+
+  // Whether the file changed since construction or the previous call.
+  inline bool Poll() {
+    const auto last_write_time = GetLastWriteTime();
+    if (last_write_time == last_write_time_) {
+      return false;
+    }
+    last_write_time_ = last_write_time;
+    return true;
+  }
+
+ private:
+  inline std::filesystem::file_time_type GetLastWriteTime() const {
+    std::error_code error{};
+    const auto last_write_time = std::filesystem::last_write_time(path_, error);
+    return error ? std::filesystem::file_time_type::min() : last_write_time;
+  }
+
+  std::filesystem::path path_;
+  std::filesystem::file_time_type last_write_time_;
+};
+}  // namespace utils::file
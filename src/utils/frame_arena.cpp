@@ -0,0 +1,166 @@
+#include "frame_arena.h"
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+
+#include "numa.h"
+
+namespace {
+// Block size of new arenas.
+constexpr size_t kInitialCapacity = 64 * 1024;
+
+std::atomic<uint64_t> current_frame = 0;
+
+std::atomic<uint64_t> global_allocations = 0;
+
+// Arenas of all threads that ever asked for one, kept after the threads exit.
+std::mutex arenas_mutex;
+std::vector<std::unique_ptr<utils::memory::FrameArena>> arenas;
+}  // namespace
+
+utils::memory::FrameArena::FrameArena(size_t capacity)
+    : block_(static_cast<std::byte*>(utils::numa::AllocatePages(capacity))),
+      capacity_(capacity),
+      capacity_bytes_(capacity) {
+  assert(block_ != nullptr);
+}
+
+utils::memory::FrameArena::~FrameArena() {
+  FreeHeapBlocks();
+  utils::numa::FreePages(block_);
+}
+
+void utils::memory::FrameArena::Reset() {
+  FreeHeapBlocks();
+
+  // Grow to fit the largest frame so far, with room for alignment. The pages
+  // are committed on first touch, by the thread that owns the arena.
+  if (heap_bytes_ > 0) {
+    utils::numa::FreePages(block_);
+    capacity_ = std::bit_ceil(
+        high_water_bytes_.load(std::memory_order_relaxed) * 5 / 4);
+    capacity_bytes_.store(capacity_, std::memory_order_relaxed);
+    block_ = static_cast<std::byte*>(utils::numa::AllocatePages(capacity_));
+    assert(block_ != nullptr);
+  }
+  used_ = 0;
+  heap_bytes_ = 0;
+  used_bytes_.store(0, std::memory_order_relaxed);
+}
+
+utils::memory::FrameArenaStats utils::memory::FrameArena::GetStats() const {
+  return {
+      .used_bytes = used_bytes_.load(std::memory_order_relaxed),
+      .high_water_bytes = high_water_bytes_.load(std::memory_order_relaxed),
+      .capacity_bytes = capacity_bytes_.load(std::memory_order_relaxed),
+      .heap_allocations = heap_allocations_.load(std::memory_order_relaxed)};
+}
+
+void utils::memory::FrameArena::FreeHeapBlocks() {
+  for (const auto& block : heap_blocks_) {
+    std::pmr::new_delete_resource()->deallocate(block.pointer, block.bytes,
+                                                block.alignment);
+  }
+  heap_blocks_.clear();
+}
+
+void* utils::memory::FrameArena::do_allocate(size_t bytes, size_t alignment) {
+  const auto address = reinterpret_cast<uintptr_t>(block_);
+  const size_t offset =
+      ((address + used_ + alignment - 1) & ~(alignment - 1)) - address;
+  void* pointer = nullptr;
+  if (offset + bytes <= capacity_) {
+    pointer = block_ + offset;
+    used_ = offset + bytes;
+  } else {
+    pointer = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    heap_blocks_.push_back({pointer, bytes, alignment});
+    heap_bytes_ += bytes;
+    heap_allocations_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  const size_t used_bytes = used_ + heap_bytes_;
+  used_bytes_.store(used_bytes, std::memory_order_relaxed);
+  if (used_bytes > high_water_bytes_.load(std::memory_order_relaxed)) {
+    high_water_bytes_.store(used_bytes, std::memory_order_relaxed);
+  }
+  return pointer;
+}
+
+utils::memory::FrameArena& utils::memory::GetFrameArena() {
+  thread_local FrameArena* arena = nullptr;
+  thread_local uint64_t arena_frame = 0;
+  if (arena == nullptr) {
+    std::scoped_lock lock(arenas_mutex);
+    arena = arenas.emplace_back(std::make_unique<FrameArena>(kInitialCapacity))
+                .get();
+  }
+
+  const uint64_t frame = current_frame.load(std::memory_order_acquire);
+  if (frame != arena_frame) {
+    arena->Reset();
+    arena_frame = frame;
+  }
+  return *arena;
+}
+
+void utils::memory::BeginFrame() {
+  current_frame.fetch_add(1, std::memory_order_release);
+}
+
+utils::memory::FrameArenaStats utils::memory::GetFrameArenaStats() {
+  FrameArenaStats total{};
+  std::scoped_lock lock(arenas_mutex);
+  for (const auto& arena : arenas) {
+    const auto stats = arena->GetStats();
+    total.used_bytes += stats.used_bytes;
+    total.high_water_bytes += stats.high_water_bytes;
+    total.capacity_bytes += stats.capacity_bytes;
+    total.heap_allocations += stats.heap_allocations;
+  }
+  return total;
+}
+
+uint64_t utils::memory::GetGlobalAllocations() {
+  return global_allocations.load(std::memory_order_relaxed);
+}
+
+// Replacements of the global allocation functions that count their calls. The
+// array and non-throwing forms call these.
+void* operator new(size_t bytes) {
+  global_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = std::malloc(bytes == 0 ? 1 : bytes);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void* operator new(size_t bytes, std::align_val_t alignment) {
+  global_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = _aligned_malloc(bytes == 0 ? 1 : bytes,
+                                  static_cast<size_t>(alignment));
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+  _aligned_free(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+  _aligned_free(pointer);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace utils::memory {
+struct FrameArenaStats {
+  // Bytes handed out since the last reset.
+  size_t used_bytes;
+  // Most bytes handed out between two resets.
+  size_t high_water_bytes;
+  // Bytes of the arena block.
+  size_t capacity_bytes;
+  // Allocations that did not fit the block and went to the heap.
+  size_t heap_allocations;
+};
+
+// Bump pointer memory resource. Deallocation does nothing; `Reset` frees
+// everything at once. Allocations that do not fit go to the heap, and the
+// next `Reset` grows the block to the high water mark, so a steady workload
+// stops allocating from the heap after its first frames.
+class FrameArena : public std::pmr::memory_resource {
+ public:
+  explicit FrameArena(size_t capacity);
+
+  ~FrameArena() override;
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  void Reset();
+
+  FrameArenaStats GetStats() const;
+
+ private:
+  struct HeapBlock {
+    void* pointer;
+    size_t bytes;
+    size_t alignment;
+  };
+
+  void FreeHeapBlocks();
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+
+  inline void do_deallocate(void*, size_t, size_t) override {}
+
+  inline bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  std::byte* block_;
+  size_t capacity_;
+  size_t used_ = 0;
+  size_t heap_bytes_ = 0;
+  std::vector<HeapBlock> heap_blocks_;
+  // Read by other threads for statistics.
+  std::atomic<size_t> capacity_bytes_;
+  std::atomic<size_t> used_bytes_ = 0;
+  std::atomic<size_t> high_water_bytes_ = 0;
+  std::atomic<size_t> heap_allocations_ = 0;
+};
+
+// Arena of the calling thread for data of the current frame. It is reset the
+// first time the thread asks for it after `BeginFrame`, so do not keep the
+// reference across frames.
+FrameArena& GetFrameArena();
+
+// Start a new frame. Call when no data of the last frame is in use any more.
+void BeginFrame();
+
+// Statistics summed over the arenas of all threads.
+FrameArenaStats GetFrameArenaStats();
+
+// Calls of the global `operator new` on any thread since the process started.
+// The difference across a frame is the heap use the arenas did not absorb,
+// which is zero in the steady state.
+uint64_t GetGlobalAllocations();
+
+// `count` uninitialized elements from the calling thread's frame arena, valid
+// until the next frame.
+template <typename T>
+std::span<T> AllocateFrameArray(size_t count) {
+  static_assert(std::is_trivially_default_constructible_v<T> &&
+                std::is_trivially_destructible_v<T>);
+  return {static_cast<T*>(
+              GetFrameArena().allocate(count * sizeof(T), alignof(T))),
+          count};
+}
+}  // namespace utils::memory
@@ -0,0 +1,215 @@
+#include "numa.h"
+
+// Keep `std::min` and `std::max` usable.
+#define NOMINMAX
+#include <Windows.h>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <string>
+
+#include "trace.h"
+
+namespace {
+thread_local unsigned int current_node = 0;
+}  // namespace
+
+std::vector<utils::numa::Node> utils::numa::GetNodes() {
+  std::vector<Node> nodes{};
+  ULONG highest_node_number = 0;
+  if (GetNumaHighestNodeNumber(&highest_node_number)) {
+    for (ULONG number = 0; number <= highest_node_number; ++number) {
+      GROUP_AFFINITY affinity{};
+      if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(number),
+                                      &affinity) ||
+          affinity.Mask == 0) {
+        continue;
+      }
+      nodes.push_back(
+          {.number = static_cast<unsigned int>(number),
+           .group = affinity.Group,
+           .processor_mask = affinity.Mask,
+           .processor_count =
+               static_cast<unsigned int>(std::popcount(affinity.Mask))});
+    }
+  }
+
+  if (nodes.empty()) {
+    const DWORD processor_count =
+        std::clamp(GetActiveProcessorCount(0), DWORD{1},
+                   static_cast<DWORD>(sizeof(KAFFINITY) * 8));
+    nodes.push_back(
+        {.number = 0,
+         .group = 0,
+         .processor_mask =
+             ~KAFFINITY{} >> (sizeof(KAFFINITY) * 8 - processor_count),
+         .processor_count = static_cast<unsigned int>(processor_count)});
+  }
+  return nodes;
+}
+
+void* utils::numa::AllocatePages(size_t bytes) {
+  return VirtualAlloc(nullptr, std::max(bytes, size_t{1}),
+                      MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+void utils::numa::FreePages(void* pages) {
+  if (pages != nullptr) {
+    VirtualFree(pages, 0, MEM_RELEASE);
+  }
+}
+
+utils::numa::ThreadPool::ThreadPool(std::vector<Node> nodes)
+    : nodes_(std::move(nodes)) {
+  for (const auto& node : nodes_) {
+    node_states_.push_back(std::make_unique<NodeState>());
+    worker_count_ += node.processor_count;
+  }
+  for (auto node_index = 0U; node_index < nodes_.size(); ++node_index) {
+    for (auto worker_index = 0U;
+         worker_index < nodes_[node_index].processor_count; ++worker_index) {
+      workers_.emplace_back(
+          [this, node_index, worker_index](std::stop_token stop_token) {
+            RunWorker(stop_token, node_index, worker_index);
+          });
+    }
+  }
+}
+
+void utils::numa::ThreadPool::ParallelFor(
+    size_t count, size_t chunk_size,
+    FunctionRef<void(size_t, size_t)> function) {
+  if (count == 0) {
+    return;
+  }
+  chunk_size = std::max(chunk_size, size_t{1});
+  std::scoped_lock job_lock(job_mutex_);
+
+  // Shares proportional to the processors of each node, in whole chunks.
+  const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+  size_t processors_before = 0;
+  for (size_t node_index = 0; node_index < nodes_.size(); ++node_index) {
+    auto& state = *node_states_[node_index];
+    const size_t first_chunk = chunk_count * processors_before / worker_count_;
+    processors_before += nodes_[node_index].processor_count;
+    const size_t last_chunk = chunk_count * processors_before / worker_count_;
+    state.next.store(first_chunk * chunk_size, std::memory_order_relaxed);
+    state.end = std::min(last_chunk * chunk_size, count);
+  }
+
+  range_function_ = &function;
+  node_function_ = nullptr;
+  chunk_size_ = chunk_size;
+  Dispatch();
+}
+
+void utils::numa::ThreadPool::ForEachNode(
+    FunctionRef<void(unsigned int)> function) {
+  std::scoped_lock job_lock(job_mutex_);
+  range_function_ = nullptr;
+  node_function_ = &function;
+  Dispatch();
+}
+
+unsigned int utils::numa::ThreadPool::CurrentNode() { return current_node; }
+
+std::vector<utils::numa::ThreadPoolNodeStats>
+utils::numa::ThreadPool::GetStats() const {
+  std::vector<ThreadPoolNodeStats> stats{};
+  for (const auto& state : node_states_) {
+    stats.push_back(
+        {.items = state->items.load(std::memory_order_relaxed),
+         .stolen_items = state->stolen_items.load(std::memory_order_relaxed),
+         .busy_seconds = static_cast<double>(state->busy_nanoseconds.load(
+                             std::memory_order_relaxed)) *
+                         1.0e-9});
+  }
+  return stats;
+}
+
+void utils::numa::ThreadPool::ResetStats() {
+  for (auto& state : node_states_) {
+    state->items.store(0, std::memory_order_relaxed);
+    state->stolen_items.store(0, std::memory_order_relaxed);
+    state->busy_nanoseconds.store(0, std::memory_order_relaxed);
+  }
+}
+
+void utils::numa::ThreadPool::Dispatch() {
+  std::unique_lock lock(mutex_);
+  busy_workers_ = worker_count_;
+  ++generation_;
+  job_available_.notify_all();
+  job_done_.wait(lock, [this] { return busy_workers_ == 0; });
+}
+
+void utils::numa::ThreadPool::RunWorker(std::stop_token stop_token,
+                                        unsigned int node_index,
+                                        unsigned int worker_index) {
+  GROUP_AFFINITY affinity{};
+  affinity.Mask = static_cast<KAFFINITY>(nodes_[node_index].processor_mask);
+  affinity.Group = nodes_[node_index].group;
+  SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+  current_node = node_index;
+  utils::trace::SetThreadName("node " + std::to_string(node_index) +
+                              " worker " + std::to_string(worker_index));
+
+  uint64_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock lock(mutex_);
+      if (!job_available_.wait(lock, stop_token, [&] {
+            return generation_ != seen_generation;
+          })) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    if (node_function_ != nullptr) {
+      if (worker_index == 0) {
+        auto scope = utils::trace::Scope("for each node");
+        (*node_function_)(node_index);
+      }
+    } else {
+      auto scope = utils::trace::Scope("parallel for");
+      RunChunks(node_index);
+    }
+
+    std::scoped_lock lock(mutex_);
+    if (--busy_workers_ == 0) {
+      job_done_.notify_one();
+    }
+  }
+}
+
+void utils::numa::ThreadPool::RunChunks(unsigned int node_index) {
+  const auto start_time = std::chrono::steady_clock::now();
+  auto& own_state = *node_states_[node_index];
+
+  // The own share first, then help the other nodes.
+  for (size_t i = 0; i < node_states_.size(); ++i) {
+    auto& state = *node_states_[(node_index + i) % node_states_.size()];
+    while (true) {
+      const size_t begin =
+          state.next.fetch_add(chunk_size_, std::memory_order_relaxed);
+      if (begin >= state.end) {
+        break;
+      }
+      const size_t end = std::min(begin + chunk_size_, state.end);
+      (*range_function_)(begin, end);
+      own_state.items.fetch_add(end - begin, std::memory_order_relaxed);
+      if (i > 0) {
+        own_state.stolen_items.fetch_add(end - begin,
+                                         std::memory_order_relaxed);
+      }
+    }
+  }
+
+  own_state.busy_nanoseconds.fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start_time)
+          .count(),
+      std::memory_order_relaxed);
+}
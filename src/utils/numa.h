@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../common/function_ref.h"
+
+namespace utils::numa {
+struct Node {
+  unsigned int number;
+  // Processor group and the mask of the node's processors within it.
+  uint16_t group;
+  uint64_t processor_mask;
+  unsigned int processor_count;
+};
+
+// NUMA nodes that have processors, or a single node with the processors of
+// group 0 if the topology is not available.
+std::vector<Node> GetNodes();
+
+// Committed, zeroed pages that get their physical memory on first access, i.e.
+// on the node of the thread that touches them first.
+void* AllocatePages(size_t bytes);
+void FreePages(void* pages);
+
+template <typename T>
+class FirstTouchBuffer {
+  static_assert(std::is_trivially_default_constructible_v<T> &&
+                std::is_trivially_destructible_v<T>);
+
+ public:
+  inline explicit FirstTouchBuffer(size_t size)
+      : elements_(static_cast<T*>(AllocatePages(size * sizeof(T))), size) {
+    assert(elements_.data() != nullptr);
+  }
+
+  inline ~FirstTouchBuffer() { FreePages(elements_.data()); }
+
+  FirstTouchBuffer(const FirstTouchBuffer&) = delete;
+  FirstTouchBuffer& operator=(const FirstTouchBuffer&) = delete;
+
+  inline T& operator[](size_t index) { return elements_[index]; }
+
+  inline const T& operator[](size_t index) const { return elements_[index]; }
+
+  inline size_t size() const { return elements_.size(); }
+
+  inline std::span<T> Elements() { return elements_; }
+
+  inline std::span<const T> Elements() const { return elements_; }
+
+ private:
+  std::span<T> elements_;
+};
+
+struct ThreadPoolNodeStats {
+  // Indices processed by the workers of the node.
+  size_t items;
+  // Indices taken from the share of another node.
+  size_t stolen_items;
+  // Summed time the workers of the node spent in jobs.
+  double busy_seconds;
+};
+
+// Worker threads pinned to the processors of their NUMA node. Jobs split their
+// index range into one contiguous share per node, so the same indices run on
+// the same node every time and memory first touched by a job stays local.
+// Workers that run out of work take chunks from other nodes.
+class ThreadPool {
+ public:
+  explicit ThreadPool(std::vector<Node> nodes);
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Call `function(begin, end)` for chunks of `chunk_size` indices of
+  // `[0, count)` and wait for all of them. Jobs from several threads run one
+  // after another. Not reentrant.
+  void ParallelFor(size_t count, size_t chunk_size,
+                   FunctionRef<void(size_t, size_t)> function);
+
+  // Call `function(node_index)` once on a worker of every node and wait.
+  void ForEachNode(FunctionRef<void(unsigned int)> function);
+
+  // Index of the node the calling worker is pinned to, 0 for other threads.
+  static unsigned int CurrentNode();
+
+  inline size_t NodeCount() const { return nodes_.size(); }
+
+  inline std::span<const Node> Nodes() const { return nodes_; }
+
+  std::vector<ThreadPoolNodeStats> GetStats() const;
+
+  void ResetStats();
+
+ private:
+  // Work share and counters of a node, on its own cache line.
+  struct alignas(64) NodeState {
+    std::atomic<size_t> next;
+    size_t end;
+    std::atomic<size_t> items;
+    std::atomic<size_t> stolen_items;
+    std::atomic<int64_t> busy_nanoseconds;
+  };
+
+  void RunWorker(std::stop_token stop_token, unsigned int node_index,
+                 unsigned int worker_index);
+
+  void RunChunks(unsigned int node_index);
+
+  void Dispatch();
+
+  std::vector<Node> nodes_;
+  std::vector<std::unique_ptr<NodeState>> node_states_;
+  unsigned int worker_count_ = 0;
+
+  // Current job, set by `Dispatch` while all workers are idle.
+  const FunctionRef<void(size_t, size_t)>* range_function_ = nullptr;
+  const FunctionRef<void(unsigned int)>* node_function_ = nullptr;
+  size_t chunk_size_ = 1;
+
+  // Held by the thread whose job runs.
+  std::mutex job_mutex_;
+  std::mutex mutex_;
+  std::condition_variable_any job_available_;
+  std::condition_variable job_done_;
+  uint64_t generation_ = 0;
+  unsigned int busy_workers_ = 0;
+  // Declared last, so the threads stop before the state they use goes away.
+  std::vector<std::jthread> workers_;
+};
+}  // namespace utils::numa
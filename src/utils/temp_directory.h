@@ -0,0 +1,34 @@
+#pragma once
+
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+namespace utils::file {
+// Directory for the temporary files of one run, created empty and deleted with
+// everything in it on destruction. Its path should be unique to the process,
+// so that concurrent runs do not share files.
+class TempDirectory {
+ public:
+  inline explicit TempDirectory(std::filesystem::path path)
+      : path_(std::move(path)) {
+    // Left over by a run that crashed.
+    std::error_code error{};
+    std::filesystem::remove_all(path_, error);
+    std::filesystem::create_directories(path_, error);
+  }
+
+  TempDirectory(const TempDirectory&) = delete;
+  TempDirectory& operator=(const TempDirectory&) = delete;
+
+  inline ~TempDirectory() {
+    std::error_code error{};
+    std::filesystem::remove_all(path_, error);
+  }
+
+  inline const std::filesystem::path& Path() const { return path_; }
+
+ private:
+  std::filesystem::path path_;
+};
+}  // namespace utils::file
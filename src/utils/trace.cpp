@@ -0,0 +1,170 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+struct Event {
+  const char* name;
+  int64_t begin_time;
+  int64_t end_time;
+};
+
+// Events per thread; older ones are overwritten.
+constexpr size_t kEventCapacity = 8192;
+// Events left out of a dump, so threads that still finish a scope after the
+// capture never write to a slot that is being read.
+constexpr size_t kEventMargin = 64;
+
+// Written only by its thread. `next` is published after the event, so readers
+// see every event below it.
+struct ThreadBuffer {
+  unsigned int thread_id;
+  std::string name;
+  std::atomic<uint64_t> next;
+  std::array<Event, kEventCapacity> events;
+};
+
+std::atomic<bool> capturing = false;
+// From the start of a capture until it was written.
+std::atomic<bool> capture_pending = false;
+std::atomic<unsigned int> frames_left = 0;
+std::atomic<int64_t> capture_begin_time = 0;
+std::atomic<int64_t> capture_end_time = 0;
+
+// Buffers of all threads that ever recorded, kept after the threads exit.
+std::mutex buffers_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+thread_local ThreadBuffer* thread_buffer = nullptr;
+
+inline int64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+ThreadBuffer& GetThreadBuffer() {
+  if (thread_buffer == nullptr) {
+    std::scoped_lock lock(buffers_mutex);
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->thread_id = static_cast<unsigned int>(buffers.size()) + 1;
+    buffer->name = "thread " + std::to_string(buffer->thread_id);
+    thread_buffer = buffers.emplace_back(std::move(buffer)).get();
+  }
+  return *thread_buffer;
+}
+
+// Quote `text` as a JSON string.
+std::string Quote(std::string_view text) {
+  std::string quoted = "\"";
+  for (const char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+    }
+    quoted += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+  }
+  return quoted + "\"";
+}
+
+// Nanoseconds to the microseconds of the trace format.
+std::string ToMicroseconds(int64_t nanoseconds) {
+  return std::to_string(nanoseconds / 1000) + "." +
+         std::to_string(nanoseconds % 1000 / 100);
+}
+}  // namespace
+
+void utils::trace::StartCapture(unsigned int frame_count) {
+  bool pending = false;
+  if (frame_count == 0 ||
+      !capture_pending.compare_exchange_strong(pending, true,
+                                               std::memory_order_acquire)) {
+    return;
+  }
+  frames_left.store(frame_count, std::memory_order_relaxed);
+  capture_begin_time.store(Now(), std::memory_order_relaxed);
+  capturing.store(true, std::memory_order_release);
+}
+
+bool utils::trace::EndFrame() {
+  if (!capturing.load(std::memory_order_acquire) ||
+      frames_left.fetch_sub(1, std::memory_order_relaxed) != 1) {
+    return false;
+  }
+  capture_end_time.store(Now(), std::memory_order_relaxed);
+  capturing.store(false, std::memory_order_release);
+  return true;
+}
+
+bool utils::trace::WriteJson(const std::filesystem::path& path) {
+  auto file = std::ofstream(path, std::ios::trunc);
+  if (!file) {
+    capture_pending.store(false, std::memory_order_release);
+    return false;
+  }
+
+  const int64_t begin_time = capture_begin_time.load(std::memory_order_relaxed);
+  const int64_t end_time = capture_end_time.load(std::memory_order_relaxed);
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  const auto separate = [&] {
+    if (!first) {
+      file << ",\n";
+    }
+    first = false;
+  };
+
+  std::scoped_lock lock(buffers_mutex);
+  for (const auto& buffer : buffers) {
+    separate();
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+         << buffer->thread_id << ",\"args\":{\"name\":" << Quote(buffer->name)
+         << "}}";
+
+    const uint64_t next = buffer->next.load(std::memory_order_acquire);
+    const uint64_t oldest =
+        next > kEventCapacity - kEventMargin
+            ? next - (kEventCapacity - kEventMargin)
+            : 0;
+    for (uint64_t i = oldest; i < next; ++i) {
+      const auto& event = buffer->events[i % kEventCapacity];
+      if (event.end_time < begin_time || event.begin_time > end_time) {
+        continue;
+      }
+      separate();
+      file << "{\"name\":" << Quote(event.name)
+           << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id
+           << ",\"ts\":" << ToMicroseconds(event.begin_time - begin_time)
+           << ",\"dur\":"
+           << ToMicroseconds(event.end_time - event.begin_time) << "}";
+    }
+  }
+  file << "]}\n";
+  capture_pending.store(false, std::memory_order_release);
+  return static_cast<bool>(file);
+}
+
+void utils::trace::SetThreadName(std::string_view name) {
+  auto& buffer = GetThreadBuffer();
+  std::scoped_lock lock(buffers_mutex);
+  buffer.name = name;
+}
+
+int64_t utils::trace::BeginEvent() {
+  return capturing.load(std::memory_order_relaxed) ? Now() : -1;
+}
+
+void utils::trace::EndEvent(const char* name, int64_t begin_time) {
+  auto& buffer = GetThreadBuffer();
+  const uint64_t next = buffer.next.load(std::memory_order_relaxed);
+  buffer.events[next % kEventCapacity] = {
+      .name = name, .begin_time = begin_time, .end_time = Now()};
+  buffer.next.store(next + 1, std::memory_order_release);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+// Timeline of scoped events per thread, written as Chrome trace JSON that
+// chrome://tracing and Perfetto open. Every thread records into its own ring
+// buffer without locks; nothing is recorded outside of a capture.
+namespace utils::trace {
+// Record the next `frame_count` frames, as counted by `EndFrame`. Does
+// nothing until the previous capture was written by `WriteJson`, so new events
+// never overwrite the ones being written.
+void StartCapture(unsigned int frame_count);
+
+// Count a frame. Returns true once the frames of the capture are over.
+bool EndFrame();
+
+// Write the events of the last capture. Call after `EndFrame` returned true;
+// the next capture can start once it returns.
+bool WriteJson(const std::filesystem::path& path);
+
+// Name of the calling thread in the trace.
+void SetThreadName(std::string_view name);
+
+// Start time of an event, or -1 outside of a capture.
+int64_t BeginEvent();
+
+// Record an event that began at `begin_time`. `name` must outlive the capture,
+// e.g. a string literal.
+void EndEvent(const char* name, int64_t begin_time);
+
+// Records an event from construction to destruction.
+class Scope {
+ public:
+  inline explicit Scope(const char* name)
+      : name_(name), begin_time_(BeginEvent()) {}
+
+  inline ~Scope() {
+    if (begin_time_ >= 0) {
+      EndEvent(name_, begin_time_);
+    }
+  }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  const char* name_;
+  int64_t begin_time_;
+};
+}  // namespace utils::trace
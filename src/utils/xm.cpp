@@ -1,6 +1,7 @@
 #include "xm.h"
 
 #include <algorithm>
+#include <cmath>
 #include <execution>
 #include <ranges>
 
@@ -51,6 +52,104 @@ std::optional<DirectX::XMFLOAT3A> utils::xm::triangle::Intersect(
   return DirectX::XMFLOAT3A{beta, gamma, ray_param};
 }
 
+std::optional<float> utils::xm::sphere::Intersect(DirectX::FXMVECTOR center,
+                                                  float radius,
+                                                  DirectX::FXMVECTOR o,
+                                                  DirectX::FXMVECTOR d,
+                                                  float min_distance) {
+  const auto center_to_origin = DirectX::XMVectorSubtract(o, center);
+  const float b =
+      DirectX::XMVectorGetX(DirectX::XMVector3Dot(center_to_origin, d));
+  const float c = DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(
+                      center_to_origin)) -
+                  radius * radius;
+  const float discriminant = b * b - c;
+  if (discriminant < 0.0f) {
+    return std::nullopt;
+  }
+
+  const float root = std::sqrt(discriminant);
+  const float t = -b - root >= min_distance ? -b - root : -b + root;
+  if (t < min_distance) {
+    return std::nullopt;
+  }
+  return t;
+}
+
+std::optional<float> utils::xm::plane::Intersect(DirectX::FXMVECTOR point,
+                                                 DirectX::FXMVECTOR normal,
+                                                 DirectX::FXMVECTOR o,
+                                                 DirectX::GXMVECTOR d,
+                                                 float min_distance) {
+  const float denominator =
+      DirectX::XMVectorGetX(DirectX::XMVector3Dot(d, normal));
+  if (DirectX::XMScalarNearEqual(denominator, 0.0f,
+                                 utils::xm::scalar::kEpsilon)) {
+    return std::nullopt;
+  }
+
+  const float t = DirectX::XMVectorGetX(DirectX::XMVector3Dot(
+                      DirectX::XMVectorSubtract(point, o), normal)) /
+                  denominator;
+  if (t < min_distance) {
+    return std::nullopt;
+  }
+  return t;
+}
+
+std::optional<float> utils::xm::box::Intersect(DirectX::FXMVECTOR center,
+                                               DirectX::FXMVECTOR extents,
+                                               DirectX::FXMVECTOR o,
+                                               DirectX::GXMVECTOR d,
+                                               float min_distance) {
+  // Distances to the lower and upper slab planes of every axis.
+  const auto inverse_d = DirectX::XMVectorReciprocal(d);
+  const auto origin_to_center = DirectX::XMVectorSubtract(center, o);
+  const auto t_lower = DirectX::XMVectorMultiply(
+      DirectX::XMVectorSubtract(origin_to_center, extents), inverse_d);
+  const auto t_upper = DirectX::XMVectorMultiply(
+      DirectX::XMVectorAdd(origin_to_center, extents), inverse_d);
+  const auto t_enter = DirectX::XMVectorMin(t_lower, t_upper);
+  const auto t_exit = DirectX::XMVectorMax(t_lower, t_upper);
+
+  // The ray is inside of all slabs between the last entry and the first exit.
+  const float t_near = DirectX::XMVectorGetX(DirectX::XMVectorMax(
+      t_enter, DirectX::XMVectorMax(DirectX::XMVectorSplatY(t_enter),
+                                    DirectX::XMVectorSplatZ(t_enter))));
+  const float t_far = DirectX::XMVectorGetX(DirectX::XMVectorMin(
+      t_exit, DirectX::XMVectorMin(DirectX::XMVectorSplatY(t_exit),
+                                   DirectX::XMVectorSplatZ(t_exit))));
+  if (t_near > t_far || t_far < min_distance) {
+    return std::nullopt;
+  }
+  return t_near >= min_distance ? t_near : t_far;
+}
+
+DirectX::XMVECTOR utils::xm::hemisphere::SampleCosine(DirectX::FXMVECTOR normal,
+                                                      float u, float v) {
+  // Point on the unit disk lifted onto the hemisphere around z.
+  const float radius = std::sqrt(u);
+  const float angle = DirectX::XM_2PI * v;
+  const float x = radius * std::cos(angle);
+  const float y = radius * std::sin(angle);
+  const float z = std::sqrt(std::max(1.0f - u, 0.0f));
+
+  // Tangent frame of the normal without a branch on its direction.
+  DirectX::XMFLOAT3 n{};
+  DirectX::XMStoreFloat3(&n, normal);
+  const float sign = std::copysign(1.0f, n.z);
+  const float a = -1.0f / (sign + n.z);
+  const float b = n.x * n.y * a;
+  const auto tangent = DirectX::XMVectorSet(1.0f + sign * n.x * n.x * a,
+                                            sign * b, -sign * n.x, 0.0f);
+  const auto bitangent =
+      DirectX::XMVectorSet(b, sign + n.y * n.y * a, -n.y, 0.0f);
+  return DirectX::XMVectorAdd(
+      DirectX::XMVectorAdd(DirectX::XMVectorScale(tangent, x),
+                           DirectX::XMVectorScale(bitangent, y)),
+      DirectX::XMVectorScale(normal, z));
+}
+
 DirectX::XMVECTOR utils::xm::triangle::Interpolate(
     DirectX::FXMVECTOR a, DirectX::FXMVECTOR b, DirectX::FXMVECTOR c,
     DirectX::CXMVECTOR barycentrics) {
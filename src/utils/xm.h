@@ -69,6 +69,36 @@ DirectX::XMVECTOR Interpolate(DirectX::FXMVECTOR a, DirectX::FXMVECTOR b,
                               DirectX::CXMVECTOR barycentrics);
 }  // namespace triangle
 
+// Closed-form intersections of a ray from `o` along the unit direction `d`.
+// They return the distance to the first intersection at or beyond
+// `min_distance`.
+namespace sphere {
+std::optional<float> Intersect(DirectX::FXMVECTOR center, float radius,
+                               DirectX::FXMVECTOR o, DirectX::FXMVECTOR d,
+                               float min_distance);
+}  // namespace sphere
+
+namespace plane {
+std::optional<float> Intersect(DirectX::FXMVECTOR point,
+                               DirectX::FXMVECTOR normal,
+                               DirectX::FXMVECTOR o, DirectX::GXMVECTOR d,
+                               float min_distance);
+}  // namespace plane
+
+namespace box {
+// Axis aligned box; the slabs of all axes are tested at once.
+std::optional<float> Intersect(DirectX::FXMVECTOR center,
+                               DirectX::FXMVECTOR extents,
+                               DirectX::FXMVECTOR o, DirectX::GXMVECTOR d,
+                               float min_distance);
+}  // namespace box
+
+namespace hemisphere {
+// Unit direction around the unit `normal`, distributed by the cosine to it when
+// `u` and `v` are uniform in [0, 1).
+DirectX::XMVECTOR SampleCosine(DirectX::FXMVECTOR normal, float u, float v);
+}  // namespace hemisphere
+
 namespace ray {
 inline DirectX::XMVECTOR At(DirectX::FXMVECTOR origin,
                             DirectX::FXMVECTOR direction, float t) {